@@ -0,0 +1,53 @@
+#ifndef CORPUS_H
+#define CORPUS_H
+
+#include <QByteArray>
+
+// Generated C++ for the benchmarks; every size is built from the same deterministic lines
+
+// One line of generated C++; the lines cycle through comments, strings, numbers and keywords
+inline QByteArray corpusLine(qint64 n) {
+    const QByteArray number = QByteArray::number(n);
+    switch (n % 8) {
+        case 0:
+            return "// Helper " + number + " keeps the TODO list short\n";
+        case 1:
+            return "static int function" + number + "(int value, const char* name) {\n";
+        case 2:
+            return "    const char* text = \"string literal " + number + "\";\n";
+        case 3:
+            return "    /* block comment */ double ratio = " + number + ".5e-3;\n";
+        case 4:
+            return "    if (value > 0x" + QByteArray::number(n, 16) + ") {\n";
+        case 5:
+            return "        return value * " + number + ";\n";
+        case 6:
+            return "    }\n";
+        default:
+            return "    return name ? 1 : 0;\n}\n#include <vector>\n";
+    }
+}
+
+// The first bytes of the corpus
+inline QByteArray corpus(qint64 bytes) {
+    QByteArray data;
+    data.reserve(bytes + 128);
+    for (qint64 n = 0; data.size() < bytes; ++n) {
+        data += corpusLine(n);
+    }
+    data.truncate(bytes);
+    return data;
+}
+
+// Whole generated lines until there are at least the given number of lines
+inline QByteArray corpusLines(qint64 lines) {
+    QByteArray data;
+    for (qint64 n = 0, count = 0; count < lines; ++n) {
+        const QByteArray line = corpusLine(n);
+        data += line;
+        count += line.count('\n');
+    }
+    return data;
+}
+
+#endif  // CORPUS_H
@@ -0,0 +1,427 @@
+// texxy_bench: micro-benchmarks of the editor's hot paths on generated C++ corpora.
+// Every case runs the same code the editor runs and the results are printed as JSON,
+// so runs of two builds can be compared case by case.
+
+#include "corpus.h"
+#include "documentsaver.h"
+#include "editorwidget.h"
+#include "fileloader.h"
+#include "incrementalsearch.h"
+#include "languages.h"
+#include "mappedfile.h"
+#include "syntax-c.h"
+#include "texxy.h"
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMimeDatabase>
+#include <QSysInfo>
+#include <QTemporaryDir>
+#include <QTextDocument>
+#include <QTimer>
+#include <algorithm>
+#include <cstdio>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <map>
+
+namespace {
+
+constexpr qint64 DocumentLimit = Texxy::LargeFileThreshold;  // Larger corpora only fit the memory-mapped viewer
+constexpr int TimeoutMs = 10 * 60 * 1000;                    // A wait that takes longer than this counts as a failure
+constexpr qint64 CaseBudgetMs = 10000;                       // Fewer iterations are run once one takes a large part of this
+constexpr int LanguageLookups = 200000;                      // Lookups per iteration of the language cases
+
+// Streams the corpus to disk, so corpora far larger than a document never sit in memory whole
+bool writeCorpus(const QString& path, qint64 bytes) {
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    QByteArray buffer;
+    qint64 written = 0;
+    for (qint64 n = 0; written < bytes; ++n) {
+        buffer += corpusLine(n);
+        if (buffer.size() >= 1024 * 1024 || written + buffer.size() >= bytes) {
+            buffer.truncate(qMin<qint64>(buffer.size(), bytes - written));
+            if (file.write(buffer) != buffer.size()) {
+                return false;
+            }
+            written += buffer.size();
+            buffer.clear();
+        }
+    }
+    return true;
+}
+
+// Runs the event loop until signal fires with done() true; start() is called once the connection is made
+template <typename Sender, typename Signal>
+bool runUntil(Sender* sender, Signal signal, const std::function<void()>& start, const std::function<bool()>& done = [] { return true; }) {
+    QEventLoop loop;
+    bool finished = false;
+    QObject::connect(sender, signal, &loop, [&]() {
+        if (!finished && done()) {
+            finished = true;
+            loop.quit();
+        }
+    });
+    start();
+    if (!finished) {
+        QTimer::singleShot(TimeoutMs, &loop, &QEventLoop::quit);
+        loop.exec();
+    }
+    return finished;
+}
+
+// Corpus files and texts, generated once per size and shared by the cases
+class Corpora {
+   public:
+    QString file(qint64 bytes) {
+        auto it = m_files.find(bytes);
+        if (it == m_files.end()) {
+            const QString path = m_dir.filePath(QStringLiteral("corpus-%1.cpp").arg(bytes));
+            it = m_files.emplace(bytes, writeCorpus(path, bytes) ? path : QString()).first;
+        }
+        return it->second;
+    }
+
+    QString text(qint64 bytes) {
+        if (m_textBytes != bytes) {
+            m_text = QString::fromLatin1(corpus(bytes));
+            m_textBytes = bytes;
+        }
+        return m_text;
+    }
+
+    QString scratchPath() const { return m_dir.filePath(QStringLiteral("saved.cpp")); }
+    bool isValid() const { return m_dir.isValid(); }
+
+   private:
+    QTemporaryDir m_dir;
+    std::map<qint64, QString> m_files;
+    QString m_text;  // Only the most recent size is kept, the documents are big enough already
+    qint64 m_textBytes = -1;
+};
+
+// One iteration of a case: the milliseconds its timed part took, or a negative value on failure
+using Iteration = std::function<double(qint64 bytes, Corpora& corpora)>;
+
+struct Case {
+    const char* name;
+    qint64 minBytes;  // Corpus sizes outside [minBytes, maxBytes) are skipped; a 0 to 0 case does not depend on the size
+    qint64 maxBytes;
+    Iteration run;
+};
+
+double elapsedMs(const QElapsedTimer& timer) {
+    return timer.nsecsElapsed() / 1e6;
+}
+
+double highlightDocument(qint64 bytes, Corpora& corpora) {
+    QTextDocument document;
+    document.setPlainText(corpora.text(bytes));
+    CxxSyntaxHighlighter highlighter(&document);
+
+    QElapsedTimer timer;
+    timer.start();
+    highlighter.rehighlight();  // highlightBlock() for every line, with no scheduler deferring any of them
+    return elapsedMs(timer);
+}
+
+double tokenizeLines(qint64 bytes, Corpora& corpora) {
+    const QString text = corpora.text(bytes);
+    QVector<HighlightSpan> spans;
+
+    QElapsedTimer timer;
+    timer.start();
+    int state = -1;
+    for (qsizetype start = 0; start < text.size();) {
+        qsizetype end = text.indexOf(QLatin1Char('\n'), start);
+        if (end < 0) {
+            end = text.size();
+        }
+        state = CxxSyntaxHighlighter::tokenize(QStringView(text).sliced(start, end - start), state, spans);
+        start = end + 1;
+    }
+    return elapsedMs(timer);
+}
+
+// What Texxy::loadFile() runs for a file below the large file threshold
+double loadDocument(qint64 bytes, Corpora& corpora) {
+    const QString path = corpora.file(bytes);
+    if (path.isEmpty()) {
+        return -1;
+    }
+    EditorWidget editor;
+    FileLoader* loader = new FileLoader(path);
+
+    QElapsedTimer timer;
+    timer.start();
+    editor.startLoading(loader);
+    if (!runUntil(loader, &FileLoader::finished, [loader]() { loader->start(); })) {
+        return -1;
+    }
+    return elapsedMs(timer);
+}
+
+// What Texxy::loadFile() runs from the large file threshold on: mapping plus the full line index
+double loadMappedFile(qint64 bytes, Corpora& corpora) {
+    const QString path = corpora.file(bytes);
+    if (path.isEmpty()) {
+        return -1;
+    }
+    MappedFile mapped;
+
+    QElapsedTimer timer;
+    timer.start();
+    if (!mapped.open(path)) {
+        return -1;
+    }
+    // The index is handed over on the GUI thread, so indexFinished() cannot fire before the wait starts
+    if (!mapped.isIndexComplete() && !runUntil(&mapped, &MappedFile::indexFinished, []() {})) {
+        return -1;
+    }
+    return elapsedMs(timer);
+}
+
+// What Texxy::saveToPath() runs for a document
+double saveDocument(qint64 bytes, Corpora& corpora) {
+    QTextDocument document;
+    document.setPlainText(corpora.text(bytes));
+
+    QElapsedTimer timer;
+    timer.start();
+    if (!DocumentSaver::save(&document, corpora.scratchPath())) {
+        return -1;
+    }
+    return elapsedMs(timer);
+}
+
+// The search Find/Replace runs as the term is typed, from a document snapshot that is already taken
+double findMatches(qint64 bytes, Corpora& corpora, const QString& pattern, bool regex) {
+    EditorWidget editor;
+    editor.textEdit()->setPlainText(corpora.text(bytes));
+    IncrementalSearch search;
+    search.setEditor(&editor);
+    runUntil(&search, &IncrementalSearch::matchesChanged, [&]() { search.setPattern(QStringLiteral("warm up"), Qt::CaseSensitive); }, [&]() { return !search.isSearching(); });
+    search.clear();
+
+    QElapsedTimer timer;
+    timer.start();
+    if (!runUntil(&search, &IncrementalSearch::matchesChanged, [&]() { search.setPattern(pattern, Qt::CaseSensitive, regex); }, [&]() { return !search.isSearching(); })) {
+        return -1;
+    }
+    const double ms = elapsedMs(timer);
+    return search.matchCount() > 0 ? ms : -1;
+}
+
+// Find/Replace's Replace All, from the computation on a worker to the edit applied to the document
+double replaceAllMatches(qint64 bytes, Corpora& corpora) {
+    EditorWidget editor;
+    editor.textEdit()->setPlainText(corpora.text(bytes));
+    IncrementalSearch search;
+    search.setEditor(&editor);
+    if (!runUntil(&search, &IncrementalSearch::matchesChanged, [&]() { search.setPattern(QStringLiteral("return value"), Qt::CaseSensitive); },
+                  [&]() { return !search.isSearching(); })) {
+        return -1;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    if (!runUntil(&search, &IncrementalSearch::replaceFinished, [&]() { search.replaceAll(QStringLiteral("return result")); })) {
+        return -1;
+    }
+    const double ms = elapsedMs(timer);
+    return editor.textEdit()->document()->isModified() ? ms : -1;
+}
+
+double languageByName(qint64, Corpora&) {
+    static const QString names[] = {
+        QStringLiteral("main.cpp"), QStringLiteral("/usr/include/stdio.h"), QStringLiteral("README"), QStringLiteral("setup.py"),
+        QStringLiteral("archive.tar.gz"), QStringLiteral("lexer.CXX"), QStringLiteral("Makefile"), QStringLiteral("/home/user/.config/texxy.conf"),
+    };
+    const LanguageRegistry& registry = LanguageRegistry::instance();
+
+    int found = 0;
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < LanguageLookups; ++i) {
+        found += registry.forFileName(names[i % std::size(names)]) != nullptr;
+    }
+    const double ms = elapsedMs(timer);
+    return found > 0 ? ms : -1;
+}
+
+double languageByMimeType(qint64, Corpora&) {
+    QMimeDatabase db;
+    const QMimeType types[] = {db.mimeTypeForName(QStringLiteral("text/x-c++src")), db.mimeTypeForName(QStringLiteral("text/x-chdr")),
+                               db.mimeTypeForName(QStringLiteral("text/plain")), db.mimeTypeForName(QStringLiteral("text/x-python"))};
+    const LanguageRegistry& registry = LanguageRegistry::instance();
+
+    int found = 0;
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < LanguageLookups; ++i) {
+        found += registry.forMimeType(types[i % std::size(types)]) != nullptr;
+    }
+    const double ms = elapsedMs(timer);
+    return found > 0 ? ms : -1;
+}
+
+qint64 parseSize(const QString& text, bool* ok) {
+    QString digits = text.trimmed().toUpper();
+    qint64 unit = 1;
+    if (digits.endsWith(QLatin1Char('K'))) {
+        unit = 1024;
+    }
+    else if (digits.endsWith(QLatin1Char('M'))) {
+        unit = 1024 * 1024;
+    }
+    else if (digits.endsWith(QLatin1Char('G'))) {
+        unit = 1024 * 1024 * 1024;
+    }
+    if (unit != 1) {
+        digits.chop(1);
+    }
+    const qint64 value = digits.toLongLong(ok);
+    *ok = *ok && value > 0;
+    return value * unit;
+}
+
+QJsonObject measure(const Case& c, qint64 bytes, int iterations, Corpora& corpora) {
+    QVector<double> samples;
+    for (int i = 0; i < iterations; ++i) {
+        const double ms = c.run(bytes, corpora);
+        if (ms < 0) {
+            return {{"case", c.name}, {"bytes", bytes}, {"error", "failed"}};
+        }
+        samples.append(ms);
+
+        // The first iteration tells how long each takes; big corpora get fewer
+        if (i == 0) {
+            iterations = static_cast<int>(qBound<qint64>(1, CaseBudgetMs / qMax<qint64>(1, static_cast<qint64>(ms)), iterations));
+        }
+    }
+
+    std::sort(samples.begin(), samples.end());
+    double total = 0;
+    for (double ms : samples) {
+        total += ms;
+    }
+    const double best = samples.first();
+    QJsonObject result{
+        {"case", c.name},
+        {"bytes", bytes},
+        {"iterations", static_cast<int>(samples.size())},
+        {"min_ms", best},
+        {"median_ms", samples[samples.size() / 2]},
+        {"mean_ms", total / samples.size()},
+    };
+    if (bytes > 0 && best > 0) {
+        result.insert("mb_per_s", bytes / (1024.0 * 1024.0) / (best / 1000.0));
+    }
+    else if (best > 0) {
+        result.insert("ops_per_s", LanguageLookups / (best / 1000.0));
+    }
+    return result;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    // Widgets are created but never shown, so no display is needed
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QApplication app(argc, argv);
+    QApplication::setApplicationName(QStringLiteral("texxy_bench"));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Runs texxy's micro-benchmarks and prints the results as JSON."));
+    parser.addHelpOption();
+    QCommandLineOption sizesOption(QStringLiteral("sizes"), QStringLiteral("Comma-separated corpus sizes with an optional K, M or G suffix."), QStringLiteral("sizes"),
+                                   QStringLiteral("1K,64K,1M,16M"));
+    QCommandLineOption filterOption(QStringLiteral("filter"), QStringLiteral("Only runs cases whose name contains text."), QStringLiteral("text"));
+    QCommandLineOption iterationsOption(QStringLiteral("iterations"), QStringLiteral("Iterations per case and size."), QStringLiteral("n"), QStringLiteral("5"));
+    QCommandLineOption outputOption(QStringLiteral("output"), QStringLiteral("Writes the JSON to file instead of standard output."), QStringLiteral("file"));
+    parser.addOptions({sizesOption, filterOption, iterationsOption, outputOption});
+    parser.process(app);
+
+    QVector<qint64> sizes;
+    for (const QString& item : parser.value(sizesOption).split(QLatin1Char(','), Qt::SkipEmptyParts)) {
+        bool ok = false;
+        const qint64 bytes = parseSize(item, &ok);
+        if (!ok) {
+            std::fprintf(stderr, "texxy_bench: invalid size \"%s\"\n", qPrintable(item));
+            return 2;
+        }
+        sizes.append(bytes);
+    }
+    const int iterations = qMax(1, parser.value(iterationsOption).toInt());
+
+    Corpora corpora;
+    if (!corpora.isValid()) {
+        std::fprintf(stderr, "texxy_bench: cannot create a temporary directory\n");
+        return 1;
+    }
+
+    const Case cases[] = {
+        {"highlight", 1, DocumentLimit, highlightDocument},
+        {"tokenize", 1, DocumentLimit, tokenizeLines},
+        {"load", 1, DocumentLimit, loadDocument},
+        {"load-mapped", DocumentLimit, std::numeric_limits<qint64>::max(), loadMappedFile},
+        {"save", 1, DocumentLimit, saveDocument},
+        {"find", 1, DocumentLimit, [](qint64 bytes, Corpora& c) { return findMatches(bytes, c, QStringLiteral("return value"), false); }},
+        {"find-regex", 1, DocumentLimit, [](qint64 bytes, Corpora& c) { return findMatches(bytes, c, QStringLiteral("function\\d+\\("), true); }},
+        {"replace-all", 1, DocumentLimit, replaceAllMatches},
+        {"language-by-name", 0, 0, languageByName},
+        {"language-by-mime-type", 0, 0, languageByMimeType},
+    };
+
+    const QString filter = parser.value(filterOption);
+    QJsonArray results;
+    for (const Case& c : cases) {
+        if (!filter.isEmpty() && !QString::fromLatin1(c.name).contains(filter)) {
+            continue;
+        }
+        if (c.maxBytes == 0) {
+            results.append(measure(c, 0, iterations, corpora));
+            continue;
+        }
+        for (qint64 bytes : sizes) {
+            if (bytes >= c.minBytes && bytes < c.maxBytes) {
+                std::fprintf(stderr, "texxy_bench: %s, %lld bytes\n", c.name, static_cast<long long>(bytes));
+                results.append(measure(c, bytes, iterations, corpora));
+            }
+        }
+    }
+
+    const QJsonObject report{
+        {"benchmark", "texxy_bench"},
+        {"version", 1},
+        {"qt", qVersion()},
+        {"cpu", QSysInfo::currentCpuArchitecture()},
+        {"os", QSysInfo::prettyProductName()},
+        {"date", QDateTime::currentDateTimeUtc().toString(Qt::ISODate)},
+        {"results", results},
+    };
+    const QByteArray json = QJsonDocument(report).toJson();
+
+    if (parser.isSet(outputOption)) {
+        QFile file(parser.value(outputOption));
+        if (!file.open(QIODevice::WriteOnly) || file.write(json) != json.size()) {
+            std::fprintf(stderr, "texxy_bench: cannot write %s\n", qPrintable(file.fileName()));
+            return 1;
+        }
+        return 0;
+    }
+    std::fwrite(json.constData(), 1, json.size(), stdout);
+    return 0;
+}
@@ -0,0 +1,342 @@
+// texxy_latency: replays a script of typing, scrolling, pasting and searching against an
+// EditorWidget with the C++ highlighter attached, and measures each input from the moment
+// it is delivered until the viewport and gutter have painted its result. Runs headless
+// on the offscreen platform; the exit code gates on the p99 latency.
+
+#include "corpus.h"
+#include "editorwidget.h"
+#include "incrementalsearch.h"
+#include "syntax-c.h"
+#include <QAbstractEventDispatcher>
+#include <QApplication>
+#include <QClipboard>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QKeyEvent>
+#include <QKeySequence>
+#include <QScrollBar>
+#include <QTextStream>
+#include <QWheelEvent>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <map>
+
+namespace {
+
+constexpr qint64 TimeoutMs = 5000;  // An input that has not painted by then is reported as such
+constexpr qint64 NoPaintMs = 100;   // An input is not counted if it has caused no paint this long and the event loop is idle
+constexpr int SettleMs = 500;       // Idle time after loading before the first input, for the viewport's highlighting
+
+// Typing, navigation, a paste and a search over the middle of the file and its end
+const char* const DefaultScript = R"(# kind [arguments], optionally preceded by a repeat count
+goto 200
+type int counter = 0;
+key Return
+20 key Down
+10 scroll 3
+5 key PgDown
+5 key PgUp
+goto 220
+paste 40
+30 key Backspace
+find counter
+find function4
+key Ctrl+End
+type // end of file
+key Ctrl+Home
+)";
+
+// Notes that a widget received a paint event; the paint itself is over once the event loop returns
+class PaintWatcher : public QObject {
+   public:
+    using QObject::QObject;
+
+    bool eventFilter(QObject*, QEvent* event) override {
+        if (event->type() == QEvent::Paint) {
+            painted = true;
+        }
+        return false;
+    }
+
+    bool painted = false;
+};
+
+struct Sample {
+    QString kind;
+    double ms;
+};
+
+struct Step {
+    QString kind;
+    QString argument;
+    int repeat = 1;
+};
+
+QVector<Step> parseScript(const QString& script, QString* error) {
+    QVector<Step> steps;
+    const QStringList lines = script.split(QLatin1Char('\n'));
+    for (int i = 0; i < lines.size(); ++i) {
+        QString line = lines[i].trimmed();
+        if (line.isEmpty() || line.startsWith(QLatin1Char('#'))) {
+            continue;
+        }
+
+        Step step;
+        bool isCount = false;
+        const int count = line.section(QLatin1Char(' '), 0, 0).toInt(&isCount);
+        if (isCount) {
+            step.repeat = qMax(1, count);
+            line = line.section(QLatin1Char(' '), 1).trimmed();
+        }
+        step.kind = line.section(QLatin1Char(' '), 0, 0);
+        step.argument = line.section(QLatin1Char(' '), 1);
+
+        static const QStringList kinds = {"type", "key", "scroll", "paste", "find", "goto"};
+        if (!kinds.contains(step.kind)) {
+            *error = QStringLiteral("line %1: unknown input \"%2\"").arg(i + 1).arg(step.kind);
+            return {};
+        }
+        steps.append(step);
+    }
+    return steps;
+}
+
+class Replay {
+   public:
+    explicit Replay(EditorWidget* editor) : m_editor(editor) {
+        editor->textEdit()->viewport()->installEventFilter(&m_viewport);
+        editor->lineNumberArea()->installEventFilter(&m_gutter);
+        m_search.setEditor(editor);
+    }
+
+    void run(const QVector<Step>& steps) {
+        for (const Step& step : steps) {
+            for (int i = 0; i < step.repeat; ++i) {
+                runStep(step);
+            }
+        }
+    }
+
+    QVector<Sample> samples;
+    int unpainted = 0;      // Inputs that caused no paint, such as scrolling past the end
+    int timedOut = 0;       // Inputs whose paint never completed within TimeoutMs
+    int gutterPainted = 0;  // Counted inputs whose paint included the gutter
+
+   private:
+    void runStep(const Step& step) {
+        QPlainTextEdit* edit = m_editor->textEdit();
+        std::function<bool()> done = []() { return true; };
+
+        // Every character typed is a keystroke of its own, sent once the previous one is painted
+        if (step.kind == QLatin1String("type")) {
+            for (const QChar c : step.argument) {
+                QElapsedTimer timer = startInput();
+                sendKey(edit, 0, Qt::NoModifier, QString(c));
+                waitForPaint(step.kind, timer, done);
+            }
+            return;
+        }
+
+        QElapsedTimer timer = startInput();
+        if (step.kind == QLatin1String("key")) {
+            const QKeyCombination combination = QKeySequence(step.argument)[0];
+            sendKey(edit, combination.key(), combination.keyboardModifiers(), QString());
+        }
+        else if (step.kind == QLatin1String("scroll")) {
+            // 120 units of angle are one notch, which scrolls three lines
+            const int lines = step.argument.toInt();
+            const QPointF center = QRectF(edit->viewport()->rect()).center();
+            QWheelEvent wheel(center, edit->viewport()->mapToGlobal(center), QPoint(), QPoint(0, -lines * 40), Qt::NoButton, Qt::NoModifier, Qt::NoScrollPhase, false);
+            QCoreApplication::sendEvent(edit->viewport(), &wheel);
+        }
+        else if (step.kind == QLatin1String("paste")) {
+            // The clipboard is filled outside the measurement
+            QGuiApplication::clipboard()->setText(QString::fromLatin1(corpusLines(step.argument.toInt())));
+            timer.restart();
+            sendKey(edit, Qt::Key_V, Qt::ControlModifier, QString());
+        }
+        else if (step.kind == QLatin1String("find")) {
+            // What the Find/Replace dialog runs as the term is typed: the search, then the selected match
+            m_search.setPattern(step.argument, Qt::CaseSensitive);
+            done = [this]() { return !m_search.isSearching(); };
+        }
+        else if (step.kind == QLatin1String("goto")) {
+            m_editor->goToLine(step.argument.toInt() - 1);
+        }
+        waitForPaint(step.kind, timer, done);
+    }
+
+    QElapsedTimer startInput() {
+        m_viewport.painted = false;
+        m_gutter.painted = false;
+        QElapsedTimer timer;
+        timer.start();
+        return timer;
+    }
+
+    // Records the time from timer's start until done() holds and the viewport is painted
+    void waitForPaint(const QString& kind, const QElapsedTimer& timer, const std::function<bool()>& done) {
+        // The paint of an update() happens on a later pass of the event loop; the gutter is
+        // painted in the same pass as the viewport whenever it needs it
+        while (timer.elapsed() < TimeoutMs) {
+            // A pass that handled no event means no update is pending, so no paint can follow without new input
+            const bool busy = QAbstractEventDispatcher::instance()->processEvents(QEventLoop::AllEvents);
+            const bool finished = done();
+            if (finished && m_viewport.painted) {
+                samples.append({kind, timer.nsecsElapsed() / 1e6});
+                gutterPainted += m_gutter.painted ? 1 : 0;
+                return;
+            }
+            // A paint that is merely late, still queued behind other events, is waited for and counted
+            if (finished && !busy && timer.elapsed() >= NoPaintMs) {
+                ++unpainted;
+                return;
+            }
+        }
+        ++timedOut;
+    }
+
+    static void sendKey(QWidget* target, int key, Qt::KeyboardModifiers modifiers, const QString& text) {
+        if (key == 0 && !text.isEmpty()) {
+            key = text.at(0).toUpper().unicode();
+        }
+        QKeyEvent press(QEvent::KeyPress, key, modifiers, text);
+        QCoreApplication::sendEvent(target, &press);
+        QKeyEvent release(QEvent::KeyRelease, key, modifiers, text);
+        QCoreApplication::sendEvent(target, &release);
+    }
+
+    EditorWidget* m_editor;
+    PaintWatcher m_viewport;  // Watches the text viewport
+    PaintWatcher m_gutter;    // Watches the line number gutter
+    IncrementalSearch m_search;
+};
+
+double percentile(const QVector<double>& sorted, double q) {
+    if (sorted.isEmpty()) {
+        return 0;
+    }
+    const int index = qBound(0, static_cast<int>(std::ceil(q * sorted.size())) - 1, static_cast<int>(sorted.size()) - 1);
+    return sorted[index];
+}
+
+QJsonObject summarize(QVector<double> ms) {
+    std::sort(ms.begin(), ms.end());
+    return {
+        {"events", static_cast<int>(ms.size())},
+        {"p50_ms", percentile(ms, 0.50)},
+        {"p99_ms", percentile(ms, 0.99)},
+        {"max_ms", ms.isEmpty() ? 0.0 : ms.last()},
+    };
+}
+
+QJsonObject runCorpus(const QString& name, qint64 lines, const QVector<Step>& steps) {
+    EditorWidget editor;
+    editor.resize(1000, 700);
+    editor.setHighlighter(createCxxHighlighter(editor.textEdit()->document()));
+    editor.textEdit()->setPlainText(QString::fromLatin1(corpusLines(lines)));
+    editor.show();
+    editor.textEdit()->setFocus();
+
+    QElapsedTimer settle;
+    settle.start();
+    while (settle.elapsed() < SettleMs) {
+        QCoreApplication::processEvents(QEventLoop::AllEvents, SettleMs);
+    }
+
+    Replay replay(&editor);
+    replay.run(steps);
+
+    QVector<double> all;
+    std::map<QString, QVector<double>> byKind;
+    for (const Sample& sample : replay.samples) {
+        all.append(sample.ms);
+        byKind[sample.kind].append(sample.ms);
+    }
+    QJsonObject kinds;
+    for (const auto& [kind, ms] : byKind) {
+        kinds.insert(kind, summarize(ms));
+    }
+
+    QJsonObject result = summarize(all);
+    result.insert("corpus", name);
+    result.insert("lines", editor.textEdit()->document()->blockCount());
+    result.insert("unpainted", replay.unpainted);
+    result.insert("timed_out", replay.timedOut);
+    result.insert("gutter_painted", replay.gutterPainted);
+    result.insert("by_kind", kinds);
+    return result;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QApplication app(argc, argv);
+    QApplication::setApplicationName(QStringLiteral("texxy_latency"));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Replays an input script against the editor and reports input-to-paint latency as JSON."));
+    parser.addHelpOption();
+    QCommandLineOption scriptOption(QStringLiteral("script"), QStringLiteral("Input script to replay instead of the built-in one."), QStringLiteral("file"));
+    QCommandLineOption linesOption(QStringLiteral("lines"), QStringLiteral("Comma-separated line counts of the generated C++ files."), QStringLiteral("counts"),
+                                   QStringLiteral("200,100000"));
+    QCommandLineOption gateOption(QStringLiteral("max-p99"), QStringLiteral("Exits with status 1 if any file's p99 latency exceeds ms."), QStringLiteral("ms"));
+    QCommandLineOption outputOption(QStringLiteral("output"), QStringLiteral("Writes the JSON to file instead of standard output."), QStringLiteral("file"));
+    parser.addOptions({scriptOption, linesOption, gateOption, outputOption});
+    parser.process(app);
+
+    QString script = QString::fromLatin1(DefaultScript);
+    if (parser.isSet(scriptOption)) {
+        QFile file(parser.value(scriptOption));
+        if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+            std::fprintf(stderr, "texxy_latency: cannot read %s\n", qPrintable(file.fileName()));
+            return 2;
+        }
+        script = QTextStream(&file).readAll();
+    }
+    QString error;
+    const QVector<Step> steps = parseScript(script, &error);
+    if (steps.isEmpty()) {
+        std::fprintf(stderr, "texxy_latency: %s\n", error.isEmpty() ? "the script is empty" : qPrintable(error));
+        return 2;
+    }
+
+    QJsonArray runs;
+    bool withinGate = true;
+    const double gate = parser.value(gateOption).toDouble();
+    for (const QString& item : parser.value(linesOption).split(QLatin1Char(','), Qt::SkipEmptyParts)) {
+        const qint64 lines = item.toLongLong();
+        if (lines <= 0) {
+            std::fprintf(stderr, "texxy_latency: invalid line count \"%s\"\n", qPrintable(item));
+            return 2;
+        }
+        std::fprintf(stderr, "texxy_latency: %lld lines\n", static_cast<long long>(lines));
+        const QJsonObject run = runCorpus(QStringLiteral("cxx-%1").arg(lines), lines, steps);
+        if (parser.isSet(gateOption) && (run.value("p99_ms").toDouble() > gate || run.value("timed_out").toInt() > 0)) {
+            withinGate = false;
+        }
+        runs.append(run);
+    }
+
+    const QByteArray json = QJsonDocument(QJsonObject{{"harness", "texxy_latency"}, {"version", 1}, {"qt", qVersion()}, {"runs", runs}}).toJson();
+    if (parser.isSet(outputOption)) {
+        QFile file(parser.value(outputOption));
+        if (!file.open(QIODevice::WriteOnly) || file.write(json) != json.size()) {
+            std::fprintf(stderr, "texxy_latency: cannot write %s\n", qPrintable(file.fileName()));
+            return 2;
+        }
+    }
+    else {
+        std::fwrite(json.constData(), 1, json.size(), stdout);
+    }
+    return withinGate ? 0 : 1;
+}
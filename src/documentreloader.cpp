@@ -0,0 +1,65 @@
+#include "documentreloader.h"
+#include "trace.h"
+#include <QCoreApplication>
+#include <QFile>
+#include <QStringDecoder>
+#include <QThreadPool>
+
+struct DocumentReloader::State {
+    DocumentReloader* owner = nullptr;  // Only touched on the GUI thread
+};
+
+DocumentReloader::DocumentReloader(const QString& filePath, const QStringList& oldLines, QObject* parent)
+    : QObject(parent), m_filePath(filePath), m_oldLines(oldLines) {
+    m_state = std::make_shared<State>();
+    m_state->owner = this;
+}
+
+DocumentReloader::~DocumentReloader() {
+    m_state->owner = nullptr;
+}
+
+void DocumentReloader::post(const std::shared_ptr<State>& state, std::function<void(DocumentReloader*)> fn) {
+    std::weak_ptr<State> weak = state;
+    QMetaObject::invokeMethod(
+        QCoreApplication::instance(),
+        [weak, fn]() {
+            std::shared_ptr<State> s = weak.lock();
+            if (s && s->owner) {
+                fn(s->owner);
+            }
+        },
+        Qt::QueuedConnection);
+}
+
+void DocumentReloader::start() {
+    std::shared_ptr<State> state = m_state;
+    const QString filePath = m_filePath;
+    const QStringList oldLines = m_oldLines;
+
+    QThreadPool::globalInstance()->start([state, filePath, oldLines]() {
+        TRACE_SCOPE("DocumentReloader read and diff");
+
+        QFile file(filePath);
+        if (!file.open(QIODevice::ReadOnly)) {
+            QString error = file.errorString();
+            post(state, [error](DocumentReloader* reloader) { emit reloader->failed(error); });
+            return;
+        }
+        const QByteArray bytes = file.readAll();
+        if (file.error() != QFileDevice::NoError) {
+            QString error = file.errorString();
+            post(state, [error](DocumentReloader* reloader) { emit reloader->failed(error); });
+            return;
+        }
+
+        QStringDecoder decoder(QStringConverter::encodingForData(bytes).value_or(QStringConverter::Utf8));
+        QString text = decoder.decode(bytes);
+        text.replace(QLatin1String("\r\n"), QLatin1String("\n"));  // As FileLoader delivers it
+
+        // One entry per line, as the document has one block per line, including an empty last one after a final newline
+        const QStringList newLines = text.split(QLatin1Char('\n'));
+        const QVector<LineDiff::Hunk> hunks = LineDiff::diff(oldLines, newLines);
+        post(state, [hunks, newLines](DocumentReloader* reloader) { emit reloader->finished(hunks, newLines); });
+    });
+}
@@ -0,0 +1,46 @@
+#ifndef DOCUMENTRELOADER_H
+#define DOCUMENTRELOADER_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <functional>
+#include <memory>
+
+#include "linediff.h"
+
+/**
+ * @brief The DocumentReloader class
+ *        Rereads a file that changed on disk and diffs it against a snapshot of the
+ *        document's lines on a worker thread. Only the hunks that differ come back,
+ *        so applying them leaves every unchanged block, and its layout, alone. The
+ *        file is decoded the way FileLoader decodes it; signals are emitted on the
+ *        thread that owns the reloader.
+ */
+class DocumentReloader : public QObject {
+    Q_OBJECT
+
+   public:
+    // Diffs the file at filePath against oldLines, the text of the document's blocks
+    DocumentReloader(const QString& filePath, const QStringList& oldLines, QObject* parent = nullptr);
+    ~DocumentReloader() override;  // Drops the result of a reload that is still running
+
+    void start();  // Starts reading and diffing on the global thread pool
+
+   signals:
+    // Lines to replace, in ascending order, with the new lines of the file they refer to
+    void finished(const QVector<LineDiff::Hunk>& hunks, const QStringList& newLines);
+    void failed(const QString& errorString);  // The file could not be read
+
+   private:
+    struct State;  // Shared with the worker so it outlives a reloader deleted mid-job
+
+    static void post(const std::shared_ptr<State>& state, std::function<void(DocumentReloader*)> fn);
+
+    QString m_filePath;
+    QStringList m_oldLines;
+    std::shared_ptr<State> m_state;
+};
+
+#endif  // DOCUMENTRELOADER_H
@@ -0,0 +1,67 @@
+#include "documentsaver.h"
+#include <QByteArray>
+#include <QSaveFile>
+#include <QStringEncoder>
+#include <QTextBlock>
+#include <QTextDocument>
+
+bool DocumentSaver::save(const QTextDocument* document, const QString& filePath, QString* errorString) {
+    // QSaveFile writes to a temporary file next to the target, syncs it to disk in
+    // commit() and only then renames it over the target, so a crash never truncates it.
+    QSaveFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        if (errorString)
+            *errorString = file.errorString();
+        return false;
+    }
+
+    QStringEncoder encoder(QStringEncoder::Utf8);
+    QByteArray buffer;
+    buffer.reserve(BufferSize);
+
+    auto flush = [&]() {
+        if (file.write(buffer) != buffer.size()) {
+            return false;
+        }
+        buffer.resize(0);
+        return true;
+    };
+
+    for (QTextBlock block = document->begin(); block.isValid(); block = block.next()) {
+        QString text = block.text();
+
+        // Written as toPlainText() would give them: Shift+Enter line breaks as '\n', non-breaking spaces as spaces
+        for (QChar& c : text) {
+            if (c == QChar::LineSeparator || c == QChar::ParagraphSeparator) {
+                c = QLatin1Char('\n');
+            }
+            else if (c == QChar::Nbsp) {
+                c = QLatin1Char(' ');
+            }
+        }
+
+        // One extra byte for the line break written before every block but the first
+        qsizetype used = buffer.size();
+        buffer.resize(used + encoder.requiredSpace(text.size()) + 1);
+        char* out = buffer.data() + used;
+        if (block != document->begin()) {
+            *out++ = '\n';
+        }
+        out = encoder.appendToBuffer(out, text);
+        buffer.resize(out - buffer.constData());
+
+        if (buffer.size() >= BufferSize && !flush()) {
+            file.cancelWriting();
+            if (errorString)
+                *errorString = file.errorString();
+            return false;
+        }
+    }
+
+    if (!flush() || !file.commit()) {
+        if (errorString)
+            *errorString = file.errorString();
+        return false;
+    }
+    return true;
+}
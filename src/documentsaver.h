@@ -0,0 +1,28 @@
+#ifndef DOCUMENTSAVER_H
+#define DOCUMENTSAVER_H
+
+#include <QString>
+
+class QTextDocument;
+
+/**
+ * @brief The DocumentSaver class
+ *        Writes a QTextDocument to disk block by block without building a full
+ *        QString copy of it. Output goes through QSaveFile, so the target is only
+ *        replaced once the new contents are completely written and synced.
+ */
+class DocumentSaver {
+   public:
+    /**
+     * @brief Encodes the document as UTF-8 and atomically replaces filePath with it.
+     * @param document The document to save.
+     * @param filePath The target file.
+     * @param errorString Receives a description of the failure, if any.
+     * @return true if the file was written and committed.
+     */
+    static bool save(const QTextDocument* document, const QString& filePath, QString* errorString = nullptr);
+
+    static constexpr qsizetype BufferSize = 1024 * 1024;  // Encoded bytes collected before each write
+};
+
+#endif  // DOCUMENTSAVER_H
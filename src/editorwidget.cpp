@@ -1,4 +1,16 @@
 #include "editorwidget.h"
+#include "documentreloader.h"
+#include "filefollower.h"
+#include "fileloader.h"
+#include "highlightscheduler.h"
+#include "largefileview.h"
+#include "minimap.h"
+#include "swapjournal.h"
+#include "trace.h"
+#include <QFileInfo>
+#include <QHBoxLayout>
+#include <QProgressBar>
+#include <QPushButton>
 #include <QVBoxLayout>
 #include <QPainter>
 #include <QTextBlock>
@@ -10,33 +22,67 @@ EditorWidget::LineNumberArea::LineNumberArea(EditorWidget* editor) : QWidget(edi
     setAttribute(Qt::WA_OpaquePaintEvent);
 }
 
+int EditorWidget::LineNumberArea::digitWidth() {
+    if (m_cacheRatio != devicePixelRatioF() || m_cacheFont != font()) {
+        buildDigitCache();
+    }
+    return m_digitWidth;
+}
+
+void EditorWidget::LineNumberArea::buildDigitCache() {
+    const QFontMetrics metrics = fontMetrics();
+    m_cacheFont = font();
+    m_cacheRatio = devicePixelRatioF();
+    m_digitWidth = 0;
+    for (char digit = '0'; digit <= '9'; ++digit) {
+        m_digitWidth = qMax(m_digitWidth, metrics.horizontalAdvance(QLatin1Char(digit)));
+    }
+
+    // Filled with the gutter background, so painting a digit is a plain copy without blending
+    m_digits = QPixmap(QSize(m_digitWidth * 10, metrics.height()) * m_cacheRatio);
+    m_digits.setDevicePixelRatio(m_cacheRatio);
+    m_digits.fill(Qt::lightGray);
+
+    QPainter painter(&m_digits);
+    painter.setFont(m_cacheFont);
+    painter.setPen(QColor("#00008B"));
+    for (int digit = 0; digit < 10; ++digit) {
+        painter.drawText(QRect(digit * m_digitWidth, 0, m_digitWidth, metrics.height()), Qt::AlignHCenter | Qt::AlignTop, QString(QLatin1Char('0' + digit)));
+    }
+}
+
 void EditorWidget::LineNumberArea::paintEvent(QPaintEvent* event) {
+    TRACE_SCOPE("LineNumberArea::paintEvent");
     if (!m_editor || !m_editor->textEdit()) {
         qWarning() << "LineNumberArea: Editor or textEdit is null!";
         return;
     }
 
+    const int cell = digitWidth();
+    const int cellPixels = qRound(cell * m_cacheRatio);
+    const QRect area = event->rect();
     QPainter painter(this);
-    painter.fillRect(event->rect(), Qt::lightGray);
+    painter.fillRect(area, Qt::lightGray);
 
-    QTextBlock block = m_editor->textEdit()->firstVisibleBlock();
+    MyPlainTextEdit* edit = m_editor->textEdit();
+    QTextBlock block = edit->firstVisibleBlock();
     int blockNumber = block.blockNumber();
-
-    int top = static_cast<int>(m_editor->textEdit()->blockBoundingGeometry(block).translated(m_editor->textEdit()->contentOffset()).top());
-    int bottom = top + static_cast<int>(m_editor->textEdit()->blockBoundingRect(block).height());
-
-    while (block.isValid() && top <= event->rect().bottom()) {
-        if (block.isVisible() && bottom >= event->rect().top()) {
-            QString number = QString::number(blockNumber + 1);
-
-            painter.setPen(QColor("#00008B"));
-
-            painter.drawText(0, top, m_editor->lineNumberAreaWidth() - 4, fontMetrics().height(), Qt::AlignRight, number);
+    int top = qRound(edit->blockBoundingGeometry(block).translated(edit->contentOffset()).top());
+    const int right = width() - LineNumberMargin;
+
+    // Heights come from each block's existing layout; numbers are copied digit by digit from the cache
+    while (block.isValid() && top <= area.bottom()) {
+        const int bottom = top + qRound(edit->blockBoundingRect(block).height());
+        if (block.isVisible() && bottom >= area.top()) {
+            int x = right;
+            for (int number = blockNumber + 1; number > 0; number /= 10) {
+                x -= cell;
+                painter.drawPixmap(QPoint(x, top), m_digits, QRect((number % 10) * cellPixels, 0, cellPixels, m_digits.height()));
+            }
         }
 
         block = block.next();
         top = bottom;
-        bottom = top + static_cast<int>(m_editor->textEdit()->blockBoundingRect(block).height());
         ++blockNumber;
     }
 }
@@ -48,40 +94,365 @@ EditorWidget::EditorWidget(QWidget* parent) : QWidget(parent) {
 
     m_textEdit = new MyPlainTextEdit(this);
     m_lineNumberArea = new LineNumberArea(this);
-
-    layout->addWidget(m_textEdit);
+    m_highlightScheduler = new HighlightScheduler(m_textEdit, this);
+    m_minimap = new Minimap(m_textEdit, this);
+    m_journal = new SwapJournal(m_textEdit->document(), this);
+
+    auto row = new QHBoxLayout;
+    row->setSpacing(0);
+    row->addWidget(m_textEdit);
+    row->addWidget(m_minimap);
+    layout->addLayout(row);
     setLayout(layout);
 
     connect(m_textEdit, &MyPlainTextEdit::blockCountChanged, this, &EditorWidget::updateLineNumberAreaWidth);
+    m_textEdit->installEventFilter(this);
     connect(m_textEdit, &MyPlainTextEdit::updateRequest, this, &EditorWidget::updateLineNumberArea);
+    connect(m_textEdit->document(), &QTextDocument::contentsChange, this, &EditorWidget::journalChange);
+    connect(m_textEdit->document(), &QTextDocument::modificationChanged, this, [this](bool modified) {
+        if (!modified) {
+            resetJournal();
+        }
+    });
 
     updateLineNumberAreaWidth(0);
 }
 
+QWidget* EditorWidget::lineNumberArea() const {
+    return m_lineNumberArea;
+}
+
+void EditorWidget::setHighlighter(QSyntaxHighlighter* highlighter) {
+    if (m_highlighter == highlighter) {
+        return;
+    }
+
+    // Detach first so the scheduler never sees a highlighter that is being destroyed
+    QSyntaxHighlighter* previous = m_highlighter;
+    m_highlighter = highlighter;
+    m_highlightScheduler->setHighlighter(highlighter);
+    delete previous;
+}
+
 void EditorWidget::setFilePath(const QString& path) {
     m_filePath = path;
+    m_journal->setFilePath(path);
 }
 
 QString EditorWidget::filePath() const {
     return m_filePath;
 }
 
-int EditorWidget::lineNumberAreaWidth() const {
-    if (!m_textEdit) {
-        qWarning() << "EditorWidget: textEdit is null!";
-        return 0;
+bool EditorWidget::openLargeFile(const QString& path) {
+    LargeFileView* view = m_largeFileView ? m_largeFileView : new LargeFileView(this);
+    if (!view->openFile(path)) {
+        if (view != m_largeFileView) {
+            delete view;
+        }
+        return false;
     }
 
-    int digits = 1;
-    int maxLines = qMax(1, m_textEdit->blockCount());
-    while (maxLines >= 10) {
-        maxLines /= 10;
-        ++digits;
+    if (!m_largeFileView) {
+        m_largeFileView = view;
+        layout()->addWidget(m_largeFileView);
+    }
+
+    m_textEdit->hide();
+    m_lineNumberArea->hide();
+    m_minimap->hide();
+    m_largeFileView->show();
+    m_largeFileView->setFocus();
+    if (m_hasPendingViewState) {
+        m_hasPendingViewState = false;
+        m_largeFileView->verticalScrollBar()->setValue(m_pendingViewState.scrollValue);
+    }
+    return true;
+}
+
+bool EditorWidget::isModified() const {
+    return m_largeFileView ? m_largeFileView->isModified() : m_textEdit->document()->isModified();
+}
+
+void EditorWidget::startLoading(FileLoader* loader) {
+    if (m_loader) {
+        delete m_loader;
+    }
+    m_loader = loader;
+    loader->setParent(this);
+
+    if (!m_loadBar) {
+        m_loadBar = new QWidget(this);
+        auto barLayout = new QHBoxLayout(m_loadBar);
+        barLayout->setContentsMargins(4, 2, 4, 2);
+        m_loadProgress = new QProgressBar(m_loadBar);
+        m_loadProgress->setRange(0, 1000);
+        m_cancelLoadButton = new QPushButton(tr("Cancel"), m_loadBar);
+        barLayout->addWidget(m_loadProgress);
+        barLayout->addWidget(m_cancelLoadButton);
+        static_cast<QVBoxLayout*>(layout())->insertWidget(0, m_loadBar);
+    }
+    m_loadProgress->setValue(0);
+    m_loadProgress->setFormat(tr("Loading %1... %p%").arg(loader->filePath()));
+    m_loadBar->show();
+
+    // Chunks are appended without undo history; the document starts clean once loading ends
+    QTextDocument* doc = m_textEdit->document();
+    doc->setUndoRedoEnabled(false);
+    m_textEdit->clear();
+
+    connect(loader, &FileLoader::chunkLoaded, this, [doc](const QString& text) {
+        TRACE_SCOPE("EditorWidget chunk insert");
+        QTextCursor cursor(doc);
+        cursor.movePosition(QTextCursor::End);
+        cursor.insertText(text);
+    });
+    connect(loader, &FileLoader::progress, this, [this](qint64 bytesRead, qint64 totalBytes) {
+        m_loadProgress->setValue(totalBytes > 0 ? static_cast<int>(bytesRead * 1000 / totalBytes) : 1000);
+    });
+    connect(loader, &FileLoader::finished, this, &EditorWidget::finishLoading);
+    connect(loader, &FileLoader::failed, this, &EditorWidget::finishLoading);
+    connect(loader, &FileLoader::cancelled, this, &EditorWidget::finishLoading);
+    connect(m_cancelLoadButton, &QPushButton::clicked, loader, &FileLoader::cancel);
+}
+
+void EditorWidget::finishLoading() {
+    m_loadBar->hide();
+    m_textEdit->document()->setUndoRedoEnabled(true);
+    m_textEdit->document()->setModified(false);
+    markSynced();
+    if (m_loader) {
+        m_fileEncoding = m_loader->encoding();
+        m_loader->deleteLater();
+        m_loader = nullptr;
+    }
+    if (m_hasPendingViewState) {
+        m_hasPendingViewState = false;
+        setViewState(m_pendingViewState);
+    }
+    if (m_pendingLine >= 0) {
+        goToLine(m_pendingLine, m_pendingColumn);
+        m_pendingLine = -1;
+    }
+}
+
+void EditorWidget::goToLine(int line, int column) {
+    if (m_largeFileView) {
+        m_largeFileView->verticalScrollBar()->setValue(line);
+        return;
+    }
+    if (isLoading()) {
+        m_pendingLine = line;
+        m_pendingColumn = column;
+        return;
+    }
+
+    QTextBlock block = m_textEdit->document()->findBlockByNumber(line);
+    if (!block.isValid()) {
+        return;
+    }
+    QTextCursor cursor(block);
+    cursor.setPosition(block.position() + qMin(column, block.length() - 1));
+    m_textEdit->setTextCursor(cursor);
+    m_textEdit->centerCursor();
+    m_textEdit->setFocus();
+}
+
+bool EditorWidget::setFollowing(bool follow) {
+    QTextDocument* doc = m_textEdit->document();
+    if (!follow) {
+        if (m_follower) {
+            // Edits from here on are journaled against the file as far as it was read
+            m_syncedFileTime = QFileInfo(m_filePath).lastModified();
+            resetJournal();
+        }
+        delete m_follower;
+        m_follower = nullptr;
+        m_textEdit->setReadOnly(false);
+        doc->setUndoRedoEnabled(true);
+        return true;
+    }
+    if (m_follower) {
+        return true;
+    }
+    if (m_filePath.isEmpty() || m_largeFileView || isLoading() || doc->isModified()) {
+        return false;
+    }
+
+    // Appended text is not an edit, so it never enters the undo stack or marks the document modified
+    m_textEdit->setReadOnly(true);
+    doc->setUndoRedoEnabled(false);
+
+    m_follower = new FileFollower(m_filePath, m_syncedFileSize, m_fileEncoding, this);
+    connect(m_follower, &FileFollower::appended, this, &EditorWidget::appendFollowed);
+    connect(m_follower, &FileFollower::reset, this, [this]() {
+        m_textEdit->clear();
+        m_syncedFileSize = 0;
+    });
+    return true;
+}
+
+void EditorWidget::appendFollowed(const QString& text) {
+    QScrollBar* bar = m_textEdit->verticalScrollBar();
+    const bool atBottom = bar->value() == bar->maximum();
+
+    // Only the last block and the new ones change; the layout of everything above stays as it is
+    QTextCursor cursor(m_textEdit->document());
+    cursor.movePosition(QTextCursor::End);
+    cursor.insertText(text);
+    m_textEdit->document()->setModified(false);
+    m_syncedFileSize = m_follower->offset();
+
+    if (atBottom) {
+        bar->setValue(bar->maximum());
+    }
+}
+
+void EditorWidget::markSynced() {
+    const QFileInfo info(m_filePath);
+    m_syncedFileSize = info.size();
+    m_syncedFileTime = info.lastModified();
+    resetJournal();
+}
+
+void EditorWidget::journalChange(int from, int charsRemoved, int charsAdded) {
+    // A highlighter applying formats reports them as a change of equal length, but adds or undoes no step
+    QTextDocument* doc = m_textEdit->document();
+    const QPair<int, int> steps(doc->availableUndoSteps(), doc->availableRedoSteps());
+    const bool formatsOnly = charsRemoved == charsAdded && steps == m_journalSteps;
+    m_journalSteps = steps;
+
+    // Loading and following only bring the document up to its file, and highlighting changes no text
+    if (formatsOnly || isLoading() || m_follower || m_highlightScheduler->isApplyingFormats()) {
+        return;
+    }
+
+    // Only the inserted text is read, so recording an edit costs the same in any size of document
+    const int end = doc->characterCount() - 1;
+    QTextCursor cursor(doc);
+    cursor.setPosition(qMin(from, end));
+    cursor.setPosition(qMin(from + charsAdded, end), QTextCursor::KeepAnchor);
+    m_journal->record(from, charsRemoved, cursor.selectedText().replace(QChar::ParagraphSeparator, QLatin1Char('\n')));
+}
+
+void EditorWidget::resetJournal() {
+    m_journal->reset(m_syncedFileSize, m_syncedFileTime);
+}
+
+bool EditorWidget::isSyncedWithFile() const {
+    const QFileInfo info(m_filePath);
+    return info.size() == m_syncedFileSize && info.lastModified() == m_syncedFileTime;
+}
+
+void EditorWidget::reloadFromDisk() {
+    if (m_filePath.isEmpty() || m_largeFileView || isLoading() || m_follower) {
+        return;
+    }
+    delete m_reloader;
+
+    QTextDocument* doc = m_textEdit->document();
+    QStringList lines;
+    lines.reserve(doc->blockCount());
+    for (QTextBlock block = doc->begin(); block.isValid(); block = block.next()) {
+        lines.append(block.text());
+    }
+
+    auto reloader = new DocumentReloader(m_filePath, lines, this);
+    m_reloader = reloader;
+    const quint64 revision = m_highlightScheduler->revision();
+    connect(reloader, &DocumentReloader::finished, this, [this, reloader, revision](const QVector<LineDiff::Hunk>& hunks, const QStringList& newLines) {
+        m_reloader = nullptr;
+        reloader->deleteLater();
+
+        // Hunks computed for text the user has changed since would land on the wrong lines
+        if (m_highlightScheduler->revision() != revision) {
+            reloadFromDisk();
+            return;
+        }
+        applyReload(hunks, newLines);
+        markSynced();
+    });
+    connect(reloader, &DocumentReloader::failed, this, [this, reloader]() {
+        m_reloader = nullptr;
+        reloader->deleteLater();
+    });
+    reloader->start();
+}
+
+void EditorWidget::applyReload(const QVector<LineDiff::Hunk>& hunks, const QStringList& newLines) {
+    TRACE_SCOPE("EditorWidget::applyReload");
+    QTextDocument* doc = m_textEdit->document();
+    QScrollBar* bar = m_textEdit->verticalScrollBar();
+    const int scrollValue = bar->value();
+
+    QTextCursor cursor(doc);
+    cursor.beginEditBlock();
+    for (auto it = hunks.crbegin(); it != hunks.crend(); ++it) {
+        const QString text = newLines.mid(it->newStart, it->newCount).join(QLatin1Char('\n'));
+        const int lineCount = doc->blockCount();
+        if (it->oldStart + it->oldCount < lineCount) {
+            // Whole lines with their line breaks, up to the first line that stays
+            cursor.setPosition(doc->findBlockByNumber(it->oldStart).position());
+            cursor.setPosition(doc->findBlockByNumber(it->oldStart + it->oldCount).position(), QTextCursor::KeepAnchor);
+            cursor.insertText(it->newCount > 0 ? text + QLatin1Char('\n') : QString());
+        }
+        else if (it->oldStart > 0) {
+            // The hunk runs to the end, so the line break taken along is the one ending the line before it
+            const QTextBlock before = doc->findBlockByNumber(it->oldStart - 1);
+            cursor.setPosition(before.position() + before.length() - 1);
+            cursor.movePosition(QTextCursor::End, QTextCursor::KeepAnchor);
+            cursor.insertText(it->newCount > 0 ? QLatin1Char('\n') + text : QString());
+        }
+        else {
+            cursor.select(QTextCursor::Document);
+            cursor.insertText(text);
+        }
+    }
+    cursor.endEditBlock();
+
+    doc->setModified(false);
+    bar->setValue(scrollValue);
+}
+
+EditorWidget::ViewState EditorWidget::viewState() const {
+    if (m_hasPendingViewState) {
+        return m_pendingViewState;
     }
 
-    int space = 3 + fontMetrics().horizontalAdvance(QLatin1Char('9')) * digits;
+    ViewState state;
+    if (m_largeFileView) {
+        state.scrollValue = m_largeFileView->verticalScrollBar()->value();
+        return state;
+    }
+    state.cursorPosition = m_textEdit->textCursor().position();
+    state.scrollValue = m_textEdit->verticalScrollBar()->value();
+    return state;
+}
+
+void EditorWidget::setViewState(const ViewState& state) {
+    if (m_largeFileView) {
+        m_largeFileView->verticalScrollBar()->setValue(state.scrollValue);
+        return;
+    }
+    if (isLoading() || m_deferredLoad) {
+        m_pendingViewState = state;
+        m_hasPendingViewState = true;
+        return;
+    }
+
+    // The file may have changed since the session was saved
+    QTextCursor cursor(m_textEdit->document());
+    cursor.setPosition(qBound(0, state.cursorPosition, m_textEdit->document()->characterCount() - 1));
+    m_textEdit->setTextCursor(cursor);
+    m_textEdit->verticalScrollBar()->setValue(state.scrollValue);
+}
+
+int EditorWidget::lineNumberAreaWidth() const {
+    if (!m_lineNumberArea) {
+        qWarning() << "EditorWidget: lineNumberArea is null!";
+        return 0;
+    }
 
-    return space;
+    return 2 * LineNumberMargin + m_lineNumberArea->digitWidth() * qMax(1, m_lineDigits);
 }
 
 void EditorWidget::updateLineNumberArea(const QRect& rect, int dy) {
@@ -90,15 +461,14 @@ void EditorWidget::updateLineNumberArea(const QRect& rect, int dy) {
         return;
     }
 
+    // Both only schedule painting, so every request of one frame ends up in a single paint event;
+    // the width only depends on the line count and is never recomputed from here
     if (dy != 0) {
         m_lineNumberArea->scroll(0, dy);
     }
     else {
         m_lineNumberArea->update(0, rect.y(), m_lineNumberArea->width(), rect.height());
     }
-
-    if (rect.contains(m_textEdit->viewport()->rect()))
-        updateLineNumberAreaWidth(0);
 }
 
 void EditorWidget::resizeEvent(QResizeEvent* event) {
@@ -108,26 +478,52 @@ void EditorWidget::resizeEvent(QResizeEvent* event) {
     }
 
     QWidget::resizeEvent(event);
+    updateLineNumberAreaGeometry();
+    updateGeometry();
+}
 
-    QRect cr = m_textEdit->contentsRect();
-    int newWidth = lineNumberAreaWidth();
-
-    m_lineNumberArea->setGeometry(QRect(cr.left(), cr.top(), newWidth, cr.height()));
-
-    updateLineNumberAreaWidth(0);
+bool EditorWidget::eventFilter(QObject* watched, QEvent* event) {
+    if (watched == m_textEdit && (event->type() == QEvent::Resize || event->type() == QEvent::Move)) {
+        updateLineNumberAreaGeometry();
+    }
+    return QWidget::eventFilter(watched, event);
+}
 
-    m_textEdit->viewport()->update();
-    updateGeometry();
+void EditorWidget::changeEvent(QEvent* event) {
+    QWidget::changeEvent(event);
+    if (event->type() == QEvent::FontChange && m_textEdit) {
+        applyLineNumberAreaWidth();
+    }
 }
 
-void EditorWidget::updateLineNumberAreaWidth(int /* newBlockCount */) {
+void EditorWidget::updateLineNumberAreaWidth(int newBlockCount) {
     if (!m_textEdit) {
         qWarning() << "EditorWidget: textEdit is null!";
         return;
     }
 
-    const int newMargin = lineNumberAreaWidth();
-    m_textEdit->setViewportMargins(newMargin, 0, 0, 0);
+    int digits = 1;
+    for (int lines = qMax(1, newBlockCount > 0 ? newBlockCount : m_textEdit->blockCount()); lines >= 10; lines /= 10) {
+        ++digits;
+    }
+
+    // Pasting or loading changes the block count constantly, but the width only every tenfold
+    if (digits != m_lineDigits) {
+        m_lineDigits = digits;
+        applyLineNumberAreaWidth();
+    }
+}
+
+void EditorWidget::applyLineNumberAreaWidth() {
+    const int width = lineNumberAreaWidth();
+    m_textEdit->setViewportMargins(width, 0, 0, 0);
+    updateLineNumberAreaGeometry();
+    m_lineNumberArea->update();
+}
 
-    m_lineNumberArea->repaint();
+void EditorWidget::updateLineNumberAreaGeometry() {
+    // The area is a child of this widget, so the text edit's rect is moved into its coordinates,
+    // below the load bar while one is shown
+    const QRect cr = m_textEdit->contentsRect().translated(m_textEdit->pos());
+    m_lineNumberArea->setGeometry(QRect(cr.left(), cr.top(), lineNumberAreaWidth(), cr.height()));
 }
@@ -2,10 +2,28 @@
 #define EDITORWIDGET_H
 
 #include <QWidget>
+#include <QDateTime>
 #include <QPlainTextEdit>
 #include <QTextBlock>
 #include <QPainter>
+#include <QPair>
 #include <QPaintEvent>
+#include <QPixmap>
+#include <QPointer>
+#include <QStringConverter>
+#include <QSyntaxHighlighter>
+
+#include "linediff.h"
+
+class DocumentReloader;
+class FileFollower;
+class FileLoader;
+class HighlightScheduler;
+class LargeFileView;
+class Minimap;
+class SwapJournal;
+class QProgressBar;
+class QPushButton;
 
 // Subclass QPlainTextEdit to expose protected methods for editor functionality
 class MyPlainTextEdit : public QPlainTextEdit {
@@ -30,19 +48,79 @@ class EditorWidget : public QWidget {
     // Getter for text editor (MyPlainTextEdit) instance
     MyPlainTextEdit* textEdit() const { return m_textEdit; }
 
+    // The line number gutter beside the text editor
+    QWidget* lineNumberArea() const;
+
+    // Decides when each block of the document is highlighted
+    HighlightScheduler* highlightScheduler() const { return m_highlightScheduler; }
+
+    // Replaces this tab's highlighter, deleting the previous one; nullptr turns highlighting off
+    void setHighlighter(QSyntaxHighlighter* highlighter);
+    QSyntaxHighlighter* highlighter() const { return m_highlighter; }
+
     // Getter and setter for file path
     void setFilePath(const QString& path);
     QString filePath() const;
 
+    // Switches the widget to the memory-mapped editor for files above the large file threshold
+    bool openLargeFile(const QString& path);
+    bool isLargeFileMode() const { return m_largeFileView != nullptr; }
+    LargeFileView* largeFileView() const { return m_largeFileView; }
+
+    // Whether the text has unsaved edits, in either mode
+    bool isModified() const;
+
+    // Streams the loader's chunks into the document and shows a progress bar with a cancel button.
+    // The widget takes ownership of the loader; the caller starts it once its own connections are made.
+    void startLoading(FileLoader* loader);
+    bool isLoading() const { return !m_loader.isNull(); }
+
+    // Moves the cursor to a zero-based line and column; while loading, the move waits until the whole file is in
+    void goToLine(int line, int column = 0);
+
+    // Where the cursor and the view are, so a session can put them back
+    struct ViewState {
+        int cursorPosition = 0;  // Character position of the cursor
+        int scrollValue = 0;     // Vertical scroll bar value, which is the top line
+    };
+    ViewState viewState() const;
+    void setViewState(const ViewState& state);  // Like goToLine(), waits until the file is in
+
+    // Follow mode appends whatever is written to the file after it was loaded, like tail -F. The
+    // document is read-only meanwhile. Fails for untitled or modified documents and in large file mode.
+    bool setFollowing(bool follow);
+    bool isFollowing() const { return m_follower != nullptr; }
+
+    // Records the file's current size and modification time as what the document was last loaded from or saved to
+    void markSynced();
+
+    // False once the file's size or modification time differs from what markSynced() recorded
+    bool isSyncedWithFile() const;
+
+    // Rereads the changed file in the background and replaces only the lines that differ, as one undoable
+    // edit; cursor, scroll position and undo history are kept. Restarts if the document is edited meanwhile.
+    void reloadFromDisk();
+
+    // Keeps the unsaved edits of the document on disk for recovery after a crash
+    SwapJournal* swapJournal() const { return m_journal; }
+
+    // Session restore leaves background tabs empty; the window loads their file when the tab is first shown
+    void setDeferredLoad(bool deferred) { m_deferredLoad = deferred; }
+    bool isDeferredLoad() const { return m_deferredLoad; }
+
    protected:
     void resizeEvent(QResizeEvent* event) override;  // Handles resizing of the widget
+    void changeEvent(QEvent* event) override;        // Resizes the line number area when the font changes
+    bool eventFilter(QObject* watched, QEvent* event) override;  // Keeps the line number area on the text edit as the load bar moves it
 
    private:
     // Calculates the width required for the line number area
     int lineNumberAreaWidth() const;
 
-    // Updates the width of the line number area based on the number of blocks
+    // Updates the width of the line number area, but only when the number of digits in the line count changes
     void updateLineNumberAreaWidth(int newBlockCount);
+    void applyLineNumberAreaWidth();
+    void updateLineNumberAreaGeometry();  // Lays the line number area over the left margin of the text edit
 
     // Updates the line number area on scrolling or content update
     void updateLineNumberArea(const QRect& rect, int dy);
@@ -50,22 +128,66 @@ class EditorWidget : public QWidget {
     // Handles the paint event for the line number area
     void lineNumberAreaPaintEvent(QPaintEvent* event);
 
+    // Hides the progress bar and restores undo once the loader is done
+    void finishLoading();
+
+    // Adds text the followed file grew by, keeping the view at the bottom if it was there
+    void appendFollowed(const QString& text);
+
+    // Hands every edit of the text to the swap journal
+    void journalChange(int from, int charsRemoved, int charsAdded);
+    void resetJournal();  // The document matches its file again
+
+    // Replaces the lines of each hunk, bottom up so the positions of the hunks above stay valid
+    void applyReload(const QVector<LineDiff::Hunk>& hunks, const QStringList& newLines);
+
    private:
-    MyPlainTextEdit* m_textEdit = nullptr;       // Instance of MyPlainTextEdit for text editing
-    class LineNumberArea;                        // Forward declaration of LineNumberArea
-    LineNumberArea* m_lineNumberArea = nullptr;  // Line number area widget
-    QString m_filePath;                          // Stores the current file path
+    MyPlainTextEdit* m_textEdit = nullptr;               // Instance of MyPlainTextEdit for text editing
+    class LineNumberArea;                                // Forward declaration of LineNumberArea
+    LineNumberArea* m_lineNumberArea = nullptr;          // Line number area widget
+    QString m_filePath;                                  // Stores the current file path
+    HighlightScheduler* m_highlightScheduler = nullptr;  // Viewport-first highlighting of m_textEdit
+    QPointer<QSyntaxHighlighter> m_highlighter;          // Highlighter of this tab's document, owned by the document
+    Minimap* m_minimap = nullptr;                        // Overview of the document beside m_textEdit
+    LargeFileView* m_largeFileView = nullptr;            // Piece table editor used instead of m_textEdit in large file mode
+    QPointer<FileLoader> m_loader;                       // Loader currently streaming into the document, if any
+    FileFollower* m_follower = nullptr;                  // Watches the file while follow mode is on
+    QPointer<DocumentReloader> m_reloader;               // Reload currently reading and diffing the file, if any
+    qint64 m_syncedFileSize = 0;                         // Bytes of the file the document was loaded from or saved to
+    QDateTime m_syncedFileTime;                          // Modification time of the file at that point
+    QStringConverter::Encoding m_fileEncoding = QStringConverter::Utf8;  // Encoding the loader detected, for following the file
+    SwapJournal* m_journal = nullptr;                    // Unsaved edits of the document, kept on disk
+    QPair<int, int> m_journalSteps{-1, -1};              // Undo and redo steps of the document when journalChange() last ran
+    QWidget* m_loadBar = nullptr;                        // Progress bar and cancel button shown while loading
+    QProgressBar* m_loadProgress = nullptr;              // Fraction of the file read so far
+    QPushButton* m_cancelLoadButton = nullptr;           // Cancels the running loader
+    int m_pendingLine = -1;                              // Line goToLine() moves to once loading is done, or -1
+    int m_pendingColumn = 0;
+    ViewState m_pendingViewState;                        // View setViewState() restores once the file is in
+    bool m_hasPendingViewState = false;                  // m_pendingViewState is still to be applied
+    bool m_deferredLoad = false;                         // Restored tab whose file is loaded when it is first shown
+    int m_lineDigits = 0;                                // Digits the line number area is currently sized for
+
+    static constexpr int LineNumberMargin = 3;  // Space on either side of the line numbers
 
     // Nested class for displaying line numbers beside the text editor
     class LineNumberArea : public QWidget {
        public:
         explicit LineNumberArea(EditorWidget* editor);  // Constructor with editor reference
 
+        int digitWidth();  // Width of one cached digit, rebuilding the cache if the font or screen changed
+
        protected:
         void paintEvent(QPaintEvent* event) override;  // Paint the line number area
 
        private:
-        EditorWidget* m_editor;  // Reference to the parent EditorWidget
+        void buildDigitCache();  // Renders 0 to 9 once, in the current font and at the current device pixel ratio
+
+        EditorWidget* m_editor;    // Reference to the parent EditorWidget
+        QPixmap m_digits;          // The digits 0 to 9 side by side, each in a cell of m_digitWidth
+        QFont m_cacheFont;         // Font m_digits was rendered in
+        qreal m_cacheRatio = 0.0;  // Device pixel ratio m_digits was rendered at; 0 if there is no cache
+        int m_digitWidth = 0;      // Cell width, the advance of the widest digit
     };
 };
 
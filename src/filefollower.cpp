@@ -0,0 +1,93 @@
+#include "filefollower.h"
+#include "trace.h"
+#include <QFileInfo>
+
+FileFollower::FileFollower(const QString& path, qint64 offset, QStringConverter::Encoding encoding, QObject* parent)
+    : QObject(parent), m_path(path), m_file(path), m_offset(offset), m_decoder(encoding) {
+    m_file.open(QIODevice::ReadOnly);
+
+    m_readTimer.setSingleShot(true);
+    m_readTimer.setInterval(CoalesceMs);
+    connect(&m_readTimer, &QTimer::timeout, this, &FileFollower::readNew);
+
+    // The directory tells when a rotated file has been created again under the same name
+    m_watcher.addPath(path);
+    m_watcher.addPath(QFileInfo(path).absolutePath());
+    connect(&m_watcher, &QFileSystemWatcher::fileChanged, this, &FileFollower::scheduleRead);
+    connect(&m_watcher, &QFileSystemWatcher::directoryChanged, this, &FileFollower::scheduleRead);
+
+    scheduleRead();  // Catches up on what was written since offset
+}
+
+void FileFollower::scheduleRead() {
+    // Not restarted by later changes, so a file that never stops growing is still read
+    if (!m_readTimer.isActive()) {
+        m_readTimer.start();
+    }
+}
+
+bool FileFollower::reopen() {
+    QFile file(m_path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    m_file.close();
+    m_file.setFileName(m_path);
+    m_file.open(QIODevice::ReadOnly);
+    m_watcher.addPath(m_path);
+    m_offset = 0;
+    m_decoder.resetState();
+    m_carriageReturn = false;
+    emit reset();
+    return true;
+}
+
+void FileFollower::readNew() {
+    TRACE_SCOPE("FileFollower::readNew");
+
+    // A renamed or deleted file drops out of the watcher; once its old contents are read, the new file takes over
+    const bool replaced = !m_watcher.files().contains(m_path);
+    if (!m_file.isOpen() || (replaced && m_file.size() <= m_offset)) {
+        if (QFileInfo::exists(m_path)) {
+            reopen();
+        }
+        if (!m_file.isOpen()) {
+            return;
+        }
+    }
+
+    const qint64 size = m_file.size();
+    if (size < m_offset) {
+        m_offset = 0;
+        m_decoder.resetState();
+        m_carriageReturn = false;
+        emit reset();
+    }
+    if (size == m_offset || !m_file.seek(m_offset)) {
+        return;
+    }
+
+    const QByteArray bytes = m_file.read(qMin(size - m_offset, MaxReadBytes));
+    if (bytes.isEmpty()) {
+        return;
+    }
+    m_offset += bytes.size();
+
+    // A "\r\n" split across two passes still becomes one line break
+    QString text = m_decoder.decode(bytes);
+    if (m_carriageReturn) {
+        text.prepend(QLatin1Char('\r'));
+    }
+    m_carriageReturn = text.endsWith(QLatin1Char('\r'));
+    if (m_carriageReturn) {
+        text.chop(1);
+    }
+    text.replace(QLatin1String("\r\n"), QLatin1String("\n"));
+    if (!text.isEmpty()) {
+        emit appended(text);
+    }
+
+    if (m_offset < size || replaced) {
+        scheduleRead();
+    }
+}
@@ -0,0 +1,47 @@
+#ifndef FILEFOLLOWER_H
+#define FILEFOLLOWER_H
+
+#include <QFile>
+#include <QFileSystemWatcher>
+#include <QObject>
+#include <QStringDecoder>
+#include <QTimer>
+
+/**
+ * @brief The FileFollower class
+ *        Watches a growing file, such as a log, and delivers only the bytes written
+ *        after a known offset, like tail -F. Change notifications are coalesced, so a
+ *        file that is written to constantly is read a few times a second at most. A
+ *        truncated file, or one replaced by log rotation, is followed from its start.
+ */
+class FileFollower : public QObject {
+    Q_OBJECT
+
+   public:
+    // Follows path from offset, the number of bytes of it that are already known, decoding it as encoding
+    FileFollower(const QString& path, qint64 offset, QStringConverter::Encoding encoding = QStringConverter::Utf8, QObject* parent = nullptr);
+
+    qint64 offset() const { return m_offset; }  // Bytes of the current file delivered so far
+
+    static constexpr int CoalesceMs = 100;                    // Changes within this long are read in one pass
+    static constexpr qint64 MaxReadBytes = 4 * 1024 * 1024;  // Read per pass; the rest follows on the next one
+
+   signals:
+    void appended(const QString& text);  // Text written since the last pass, with "\r\n" turned into "\n" like FileLoader
+    void reset();                        // The file was truncated or replaced; appended() starts over from its beginning
+
+   private:
+    void scheduleRead();
+    void readNew();
+    bool reopen();  // Switches to the file now at m_path after a rotation
+
+    QString m_path;
+    QFile m_file;  // Kept open, so the rest of a rotated file can still be read
+    qint64 m_offset = 0;
+    QStringDecoder m_decoder;  // Stateful, so a character split across two passes decodes whole
+    bool m_carriageReturn = false;  // The last pass ended in '\r', held back in case a '\n' follows
+    QFileSystemWatcher m_watcher;
+    QTimer m_readTimer;
+};
+
+#endif  // FILEFOLLOWER_H
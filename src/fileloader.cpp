@@ -0,0 +1,120 @@
+#include "fileloader.h"
+#include "trace.h"
+#include <QCoreApplication>
+#include <QFile>
+#include <QMimeDatabase>
+#include <QStringDecoder>
+#include <QThreadPool>
+#include <atomic>
+#include <optional>
+
+struct FileLoader::State {
+    QString filePath;
+    std::atomic<bool> cancelled{false};
+    FileLoader* owner = nullptr;  // Only touched on the GUI thread
+};
+
+FileLoader::FileLoader(const QString& filePath, QObject* parent) : QObject(parent), m_filePath(filePath) {
+    m_state = std::make_shared<State>();
+    m_state->filePath = filePath;
+    m_state->owner = this;
+}
+
+FileLoader::~FileLoader() {
+    m_state->cancelled = true;
+    m_state->owner = nullptr;
+}
+
+void FileLoader::cancel() {
+    m_state->cancelled = true;
+}
+
+void FileLoader::post(const std::shared_ptr<State>& state, std::function<void(FileLoader*)> fn) {
+    std::weak_ptr<State> weak = state;
+    QMetaObject::invokeMethod(
+        QCoreApplication::instance(),
+        [weak, fn]() {
+            std::shared_ptr<State> s = weak.lock();
+            if (s && s->owner) {
+                fn(s->owner);
+            }
+        },
+        Qt::QueuedConnection);
+}
+
+void FileLoader::start() {
+    std::shared_ptr<State> state = m_state;
+
+    const bool sniff = m_sniffContent;
+
+    QThreadPool::globalInstance()->start([state, sniff]() {
+        TRACE_SCOPE("FileLoader read");
+        constexpr qint64 ChunkSize = 1024 * 1024;
+
+        QFile file(state->filePath);
+        if (!file.open(QIODevice::ReadOnly)) {
+            QString error = file.errorString();
+            post(state, [error](FileLoader* loader) { emit loader->failed(error); });
+            return;
+        }
+
+        const qint64 total = file.size();
+        qint64 bytesRead = 0;
+        QByteArray buffer(ChunkSize, Qt::Uninitialized);
+        std::optional<QStringDecoder> decoder;
+        QMimeType mime;
+        bool carriageReturn = false;  // The last chunk ended in '\r', which may start a "\r\n" split across chunks
+
+        while (!state->cancelled) {
+            qint64 n = file.read(buffer.data(), ChunkSize);
+            if (n < 0) {
+                QString error = file.errorString();
+                post(state, [error](FileLoader* loader) { emit loader->failed(error); });
+                return;
+            }
+            if (n == 0) {
+                break;
+            }
+
+            QByteArrayView bytes(buffer.constData(), n);
+            if (!decoder) {
+                const QStringConverter::Encoding encoding = QStringConverter::encodingForData(bytes).value_or(QStringConverter::Utf8);
+                decoder.emplace(encoding);
+                post(state, [encoding](FileLoader* loader) { loader->m_encoding = encoding; });
+
+                // The first chunk is already in memory, so sniffing it costs no second read of the file
+                if (sniff) {
+                    mime = QMimeDatabase().mimeTypeForFileNameAndData(state->filePath, QByteArray(buffer.constData(), qMin<qint64>(n, SniffBytes)));
+                }
+            }
+
+            // Line breaks are normalised after decoding, since in UTF-16 a 0x0D byte is not always a '\r'
+            QString text = decoder->decode(bytes);
+            if (carriageReturn) {
+                text.prepend(QLatin1Char('\r'));
+            }
+            carriageReturn = text.endsWith(QLatin1Char('\r'));
+            if (carriageReturn) {
+                text.chop(1);
+            }
+            text.replace(QLatin1String("\r\n"), QLatin1String("\n"));
+            bytesRead += n;
+            post(state, [text, bytesRead, total](FileLoader* loader) {
+                emit loader->chunkLoaded(text);
+                emit loader->progress(bytesRead, total);
+            });
+        }
+
+        if (state->cancelled) {
+            post(state, [](FileLoader* loader) { emit loader->cancelled(); });
+            return;
+        }
+
+        post(state, [mime, carriageReturn](FileLoader* loader) {
+            if (carriageReturn) {
+                emit loader->chunkLoaded(QStringLiteral("\r"));
+            }
+            emit loader->finished(mime);
+        });
+    });
+}
@@ -0,0 +1,57 @@
+#ifndef FILELOADER_H
+#define FILELOADER_H
+
+#include <QMimeType>
+#include <QObject>
+#include <QString>
+#include <QStringConverter>
+#include <functional>
+#include <memory>
+
+/**
+ * @brief The FileLoader class
+ *        Reads, decodes and optionally MIME-sniffs a file on a worker thread. Decoded text is
+ *        delivered to the GUI thread in chunks as it arrives, with "\r\n" turned into "\n";
+ *        all signals are emitted on the thread that owns the loader.
+ */
+class FileLoader : public QObject {
+    Q_OBJECT
+
+   public:
+    explicit FileLoader(const QString& filePath, QObject* parent = nullptr);
+    ~FileLoader() override;  // Cancels a load that is still running
+
+    QString filePath() const { return m_filePath; }
+
+    // Encoding detected from the first chunk; valid from the first chunkLoaded() on
+    QStringConverter::Encoding encoding() const { return m_encoding; }
+
+    // Sniffs the MIME type from the first SniffBytes already read; otherwise finished() reports an invalid type
+    void setSniffContent(bool sniff) { m_sniffContent = sniff; }
+
+    void start();  // Starts reading on the global thread pool
+
+    static constexpr qsizetype SniffBytes = 16 * 1024;  // Content sniffing never looks further into the file
+
+   public slots:
+    void cancel();  // Stops the worker after the chunk it is currently reading
+
+   signals:
+    void chunkLoaded(const QString& text);              // Next piece of decoded text, in file order
+    void progress(qint64 bytesRead, qint64 totalBytes);  // Bytes of the file, emitted after every chunk
+    void finished(const QMimeType& mimeType);           // The whole file has been delivered
+    void failed(const QString& errorString);            // The file could not be read
+    void cancelled();                                   // Loading stopped because cancel() was called
+
+   private:
+    struct State;  // Shared with the worker so it outlives a loader deleted mid-read
+
+    static void post(const std::shared_ptr<State>& state, std::function<void(FileLoader*)> fn);
+
+    QString m_filePath;
+    std::shared_ptr<State> m_state;
+    bool m_sniffContent = true;
+    QStringConverter::Encoding m_encoding = QStringConverter::Utf8;
+};
+
+#endif  // FILELOADER_H
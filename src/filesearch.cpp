@@ -0,0 +1,236 @@
+#include "filesearch.h"
+#include "textsearch.h"
+#include <QCoreApplication>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QRegularExpression>
+#include <QStringDecoder>
+#include <QThreadPool>
+#include <algorithm>
+#include <cstring>
+
+struct FileSearch::Query {
+    QString needle;        // The pattern, case folded unless case sensitive; unused in regex mode
+    QByteArray prefilter;  // UTF-8 literal every matching file contains, empty if none is known
+    Qt::CaseSensitivity cs = Qt::CaseInsensitive;
+    bool regex = false;
+    QRegularExpression re;
+    Options options;
+};
+
+struct FileSearch::State {
+    Query query;
+    std::atomic<bool> cancelled{false};
+    std::atomic<int> pending{0};  // Jobs started and not finished yet; the last one to finish reports
+    std::atomic<qint64> files{0};
+    std::atomic<qint64> bytes{0};
+    FileSearch* owner = nullptr;  // Only touched on the GUI thread
+};
+
+FileSearch::FileSearch(QObject* parent) : QObject(parent) {}
+
+FileSearch::~FileSearch() {
+    cancel();
+}
+
+bool FileSearch::isRunning() const {
+    return m_state != nullptr;
+}
+
+void FileSearch::cancel() {
+    if (m_state) {
+        m_state->cancelled = true;
+        m_state->owner = nullptr;
+        m_state.reset();
+    }
+}
+
+bool FileSearch::start(const QString& root, const QString& pattern, Qt::CaseSensitivity cs, bool regex, const Options& options) {
+    cancel();
+    m_error.clear();
+    if (pattern.isEmpty()) {
+        return false;
+    }
+
+    Query query;
+    query.cs = cs;
+    query.regex = regex;
+    query.options = options;
+    QString literal = pattern;
+    if (regex) {
+        query.re = TextSearch::regex(pattern, cs);
+        if (!query.re.isValid()) {
+            m_error = query.re.errorString();
+            return false;
+        }
+        literal = TextSearch::requiredLiteral(pattern);
+    }
+    else {
+        query.needle = cs == Qt::CaseSensitive ? pattern : TextSearch::fold(pattern);
+    }
+
+    // The byte prefilter only folds ASCII, so other literals can only rule files out case sensitively
+    const bool ascii = std::all_of(literal.cbegin(), literal.cend(), [](QChar c) { return c.unicode() < 128; });
+    if (cs == Qt::CaseSensitive || ascii) {
+        query.prefilter = literal.toUtf8();
+    }
+
+    std::shared_ptr<State> state = std::make_shared<State>();
+    state->query = query;
+    state->owner = this;
+    state->pending = 1;
+    m_state = state;
+
+    QThreadPool::globalInstance()->start([state, root]() { searchDirectory(state, root); });
+    return true;
+}
+
+void FileSearch::post(const std::shared_ptr<State>& state, std::function<void(FileSearch*)> fn) {
+    std::weak_ptr<State> weak = state;
+    QMetaObject::invokeMethod(
+        QCoreApplication::instance(),
+        [weak, fn]() {
+            std::shared_ptr<State> s = weak.lock();
+            if (s && s->owner) {
+                fn(s->owner);
+            }
+        },
+        Qt::QueuedConnection);
+}
+
+void FileSearch::jobDone(const std::shared_ptr<State>& state) {
+    if (--state->pending == 0) {
+        post(state, [](FileSearch* search) {
+            search->m_state.reset();
+            emit search->finished();
+        });
+    }
+}
+
+void FileSearch::searchDirectory(const std::shared_ptr<State>& state, const QString& path) {
+    const Options& options = state->query.options;
+    QDir::Filters filters = QDir::AllDirs | QDir::Files | QDir::NoDotAndDotDot | QDir::Readable;
+    if (!options.skipHidden) {
+        filters |= QDir::Hidden;
+    }
+
+    // Subdirectories and full batches go to jobs of their own; this job searches what is left over
+    QDirIterator it(path, options.nameFilters, filters);
+    QStringList batch;
+    qint64 batchBytes = 0;
+    while (it.hasNext() && !state->cancelled) {
+        it.next();
+        const QFileInfo info = it.fileInfo();
+        if (info.isDir()) {
+            if (info.isSymLink()) {
+                continue;  // A link could lead back up the tree
+            }
+            const QString directory = info.filePath();
+            ++state->pending;
+            QThreadPool::globalInstance()->start([state, directory]() { searchDirectory(state, directory); });
+            continue;
+        }
+        if (info.size() > options.maxFileSize) {
+            continue;
+        }
+
+        batch.append(info.filePath());
+        batchBytes += info.size();
+        if (batch.size() >= BatchFiles || batchBytes >= BatchBytes) {
+            const QStringList paths = batch;
+            ++state->pending;
+            QThreadPool::globalInstance()->start([state, paths]() {
+                searchBatch(state, paths);
+                jobDone(state);
+            });
+            batch.clear();
+            batchBytes = 0;
+        }
+    }
+
+    if (!batch.isEmpty()) {
+        searchBatch(state, batch);
+    }
+    jobDone(state);
+}
+
+void FileSearch::searchBatch(const std::shared_ptr<State>& state, const QStringList& paths) {
+    QVector<FileResult> results;
+    qint64 bytes = 0;
+    for (const QString& path : paths) {
+        if (state->cancelled) {
+            return;
+        }
+        FileResult result;
+        qint64 bytesRead = 0;
+        if (searchFile(state->query, path, result, &bytesRead, &state->cancelled)) {
+            results.append(result);
+        }
+        bytes += bytesRead;
+    }
+
+    const qint64 filesSearched = state->files += paths.size();
+    const qint64 bytesSearched = state->bytes += bytes;
+    post(state, [results, filesSearched, bytesSearched](FileSearch* search) {
+        if (!results.isEmpty()) {
+            emit search->resultsReady(results);
+        }
+        emit search->progress(filesSearched, bytesSearched);
+    });
+}
+
+bool FileSearch::searchFile(const Query& query, const QString& path, FileResult& result, qint64* bytesRead, const std::atomic<bool>* cancelled) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    // Mapped rather than read, so a file the prefilter rules out is never copied; the mapping ends with file
+    QByteArray buffer;
+    const qint64 size = file.size();
+    QByteArrayView bytes;
+    if (size == 0 || size > query.options.maxFileSize) {
+        return false;
+    }
+    if (const uchar* mapped = file.map(0, size)) {
+        bytes = QByteArrayView(reinterpret_cast<const char*>(mapped), size);
+    }
+    else {
+        buffer = file.read(size);
+        bytes = buffer;
+    }
+    *bytesRead = bytes.size();
+
+    if (query.options.skipBinary && std::memchr(bytes.data(), 0, static_cast<size_t>(qMin<qint64>(bytes.size(), BinaryProbeBytes)))) {
+        return false;
+    }
+    const QStringConverter::Encoding encoding = QStringConverter::encodingForData(bytes).value_or(QStringConverter::Utf8);
+    if (!query.prefilter.isEmpty() && encoding == QStringConverter::Utf8 && TextSearch::indexOf(bytes, query.prefilter, query.cs) < 0) {
+        return false;
+    }
+
+    // Decoded like FileLoader does it, so lines and columns agree with the document the match is opened in
+    QStringDecoder decoder(encoding);
+    QString text = decoder.decode(bytes);
+    if (text.contains(QLatin1Char('\r'))) {
+        text.replace(QLatin1String("\r\n"), QLatin1String("\n"));
+    }
+
+    QVector<int> starts;
+    QVector<int> lengths;
+    if (query.regex) {
+        TextSearch::findAll(text, query.re, 0, text.size(), MaxHitsPerFile, starts, lengths, cancelled);
+    }
+    else {
+        starts = TextSearch::findAll(query.cs == Qt::CaseSensitive ? text : TextSearch::fold(text), query.needle, MaxHitsPerFile, cancelled);
+    }
+    if (starts.isEmpty()) {
+        return false;
+    }
+
+    result.path = path;
+    result.hits = MultiDocumentSearch::describeMatches(text, starts, lengths, static_cast<int>(query.needle.size()), QLatin1Char('\n'));
+    result.capped = starts.size() >= MaxHitsPerFile;
+    return true;
+}
@@ -0,0 +1,79 @@
+#ifndef FILESEARCH_H
+#define FILESEARCH_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <atomic>
+#include <functional>
+#include <memory>
+
+#include "multidocumentsearch.h"
+
+/**
+ * @brief The FileSearch class
+ *        Find in Files. Every directory of the tree is listed by its own job on the
+ *        global thread pool, and the files it holds are searched in batches by further
+ *        jobs, so both the walk and the search spread over all cores. Each file is
+ *        memory mapped and scanned for a literal the matches must contain before any
+ *        of it is decoded, which leaves most files of a big tree at a single pass over
+ *        their bytes. Results of each batch are delivered as soon as it is done.
+ */
+class FileSearch : public QObject {
+    Q_OBJECT
+
+   public:
+    // Which files are searched
+    struct Options {
+        QStringList nameFilters;                // Wildcards such as *.cpp; empty searches every file
+        qint64 maxFileSize = 16 * 1024 * 1024;  // Bigger files are skipped
+        bool skipBinary = true;                 // Skips files with a NUL byte near the start
+        bool skipHidden = true;                 // Skips hidden files and directories such as .git
+    };
+
+    // The matches in one file
+    struct FileResult {
+        QString path;
+        QVector<MultiDocumentSearch::Hit> hits;
+        bool capped = false;  // The file has more than MaxHitsPerFile matches
+    };
+
+    explicit FileSearch(QObject* parent = nullptr);
+    ~FileSearch() override;  // Stops the running search
+
+    /**
+     * @brief Starts searching every file under root; a running search is cancelled first.
+     * @return false if pattern is empty or not a valid regular expression; nothing is reported then.
+     */
+    bool start(const QString& root, const QString& pattern, Qt::CaseSensitivity cs, bool regex, const Options& options);
+
+    void cancel();  // Stops the running search; finished() is not emitted for it
+    bool isRunning() const;
+    QString errorString() const { return m_error; }  // Why the regular expression is invalid, if it is
+
+    static constexpr int MaxHitsPerFile = 1000;
+    static constexpr qint64 BatchBytes = 8 * 1024 * 1024;  // A job searches files up to about this much data
+    static constexpr int BatchFiles = 256;                 // and at most this many files
+    static constexpr qint64 BinaryProbeBytes = 8000;       // Bytes checked for a NUL when skipping binary files
+
+   signals:
+    void resultsReady(const QVector<FileSearch::FileResult>& results);  // Files of one batch that have matches
+    void progress(qint64 filesSearched, qint64 bytesSearched);
+    void finished();  // Every file has been searched
+
+   private:
+    struct Query;  // The compiled request, shared by every job of one search
+    struct State;  // Shared with the workers so it outlives a search deleted mid-job
+
+    static void searchDirectory(const std::shared_ptr<State>& state, const QString& path);
+    static void searchBatch(const std::shared_ptr<State>& state, const QStringList& paths);
+    static bool searchFile(const Query& query, const QString& path, FileResult& result, qint64* bytesRead, const std::atomic<bool>* cancelled);
+    static void jobDone(const std::shared_ptr<State>& state);
+    static void post(const std::shared_ptr<State>& state, std::function<void(FileSearch*)> fn);
+
+    std::shared_ptr<State> m_state;  // State of the running search, replaced by every start()
+    QString m_error;
+};
+
+#endif  // FILESEARCH_H
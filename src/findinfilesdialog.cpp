@@ -0,0 +1,115 @@
+#include "findinfilesdialog.h"
+#include <QCheckBox>
+#include <QDir>
+#include <QFileDialog>
+#include <QGridLayout>
+#include <QLabel>
+#include <QLineEdit>
+#include <QPushButton>
+#include <QRegularExpression>
+#include <QSpinBox>
+
+FindInFilesDialog::FindInFilesDialog(QWidget* parent) : QDialog(parent) {
+    setWindowTitle(tr("Find in Files"));
+
+    QGridLayout* layout = new QGridLayout(this);
+
+    layout->addWidget(new QLabel(tr("Find:")), 0, 0);
+    findLineEdit = new QLineEdit(this);
+    layout->addWidget(findLineEdit, 0, 1, 1, 2);
+    connect(findLineEdit, &QLineEdit::returnPressed, this, &FindInFilesDialog::onSearchClicked);
+
+    layout->addWidget(new QLabel(tr("Directory:")), 1, 0);
+    directoryLineEdit = new QLineEdit(this);
+    layout->addWidget(directoryLineEdit, 1, 1);
+    QPushButton* browseButton = new QPushButton(tr("Browse..."), this);
+    layout->addWidget(browseButton, 1, 2);
+    connect(browseButton, &QPushButton::clicked, this, &FindInFilesDialog::onBrowseClicked);
+
+    layout->addWidget(new QLabel(tr("File names:")), 2, 0);
+    filtersLineEdit = new QLineEdit(this);
+    filtersLineEdit->setPlaceholderText(tr("*.cpp *.h (all files if empty)"));
+    layout->addWidget(filtersLineEdit, 2, 1, 1, 2);
+
+    layout->addWidget(new QLabel(tr("Skip files over:")), 3, 0);
+    maxSizeSpinBox = new QSpinBox(this);
+    maxSizeSpinBox->setRange(1, 4096);
+    maxSizeSpinBox->setValue(static_cast<int>(FileSearch::Options().maxFileSize / (1024 * 1024)));
+    maxSizeSpinBox->setSuffix(tr(" MB"));
+    layout->addWidget(maxSizeSpinBox, 3, 1, 1, 2);
+
+    matchCaseCheckBox = new QCheckBox(tr("Match case"), this);
+    layout->addWidget(matchCaseCheckBox, 4, 0);
+
+    regexCheckBox = new QCheckBox(tr("Regular expression"), this);
+    layout->addWidget(regexCheckBox, 4, 1, 1, 2);
+
+    skipBinaryCheckBox = new QCheckBox(tr("Skip binary files"), this);
+    skipBinaryCheckBox->setChecked(true);
+    layout->addWidget(skipBinaryCheckBox, 5, 0);
+
+    skipHiddenCheckBox = new QCheckBox(tr("Skip hidden files"), this);
+    skipHiddenCheckBox->setChecked(true);
+    layout->addWidget(skipHiddenCheckBox, 5, 1, 1, 2);
+
+    statusLabel = new QLabel(this);
+    layout->addWidget(statusLabel, 6, 0, 1, 3);
+
+    searchButton = new QPushButton(tr("Search"), this);
+    searchButton->setDefault(true);
+    layout->addWidget(searchButton, 7, 0);
+    connect(searchButton, &QPushButton::clicked, this, &FindInFilesDialog::onSearchClicked);
+
+    closeButton = new QPushButton(tr("Close"), this);
+    layout->addWidget(closeButton, 7, 1, 1, 2);
+    connect(closeButton, &QPushButton::clicked, this, &QDialog::accept);
+
+    setLayout(layout);
+}
+
+void FindInFilesDialog::setDirectory(const QString& path) {
+    if (directoryLineEdit->text().isEmpty()) {
+        directoryLineEdit->setText(QDir::toNativeSeparators(path));
+    }
+}
+
+void FindInFilesDialog::setRunning(bool isRunning) {
+    running = isRunning;
+    searchButton->setText(running ? tr("Stop") : tr("Search"));
+}
+
+void FindInFilesDialog::setStatus(const QString& text) {
+    statusLabel->setText(text);
+}
+
+QStringList FindInFilesDialog::parseNameFilters(const QString& text) {
+    static const QRegularExpression separators(QStringLiteral("[\\s;,]+"));
+    return text.split(separators, Qt::SkipEmptyParts);
+}
+
+void FindInFilesDialog::onBrowseClicked() {
+    const QString path = QFileDialog::getExistingDirectory(this, tr("Search in Directory"), directoryLineEdit->text());
+    if (!path.isEmpty()) {
+        directoryLineEdit->setText(QDir::toNativeSeparators(path));
+    }
+}
+
+void FindInFilesDialog::onSearchClicked() {
+    if (running) {
+        emit stopRequested();
+        return;
+    }
+
+    const QString root = QDir::fromNativeSeparators(directoryLineEdit->text());
+    if (!QDir(root).exists()) {
+        setStatus(tr("No such directory: %1").arg(directoryLineEdit->text()));
+        return;
+    }
+
+    FileSearch::Options options;
+    options.nameFilters = parseNameFilters(filtersLineEdit->text());
+    options.maxFileSize = static_cast<qint64>(maxSizeSpinBox->value()) * 1024 * 1024;
+    options.skipBinary = skipBinaryCheckBox->isChecked();
+    options.skipHidden = skipHiddenCheckBox->isChecked();
+    emit searchRequested(root, findLineEdit->text(), matchCaseCheckBox->isChecked() ? Qt::CaseSensitive : Qt::CaseInsensitive, regexCheckBox->isChecked(), options);
+}
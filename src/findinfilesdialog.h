@@ -0,0 +1,48 @@
+#ifndef FINDINFILESDIALOG_H
+#define FINDINFILESDIALOG_H
+
+#include <QDialog>
+
+#include "filesearch.h"
+
+class QCheckBox;
+class QLabel;
+class QLineEdit;
+class QPushButton;
+class QSpinBox;
+
+class FindInFilesDialog : public QDialog {
+    Q_OBJECT
+
+   public:
+    explicit FindInFilesDialog(QWidget* parent = nullptr);  // Constructor sets up UI components and layout
+
+    void setDirectory(const QString& path);                    // Directory searched when the field is still empty
+    void setRunning(bool isRunning);                           // Swaps the Search button for Stop while a search runs
+    void setStatus(const QString& text);                       // Shows progress or the outcome of the last search
+    static QStringList parseNameFilters(const QString& text);  // Splits "*.cpp *.h" or "*.cpp;*.h" into wildcards
+
+   signals:
+    void searchRequested(const QString& root, const QString& pattern, Qt::CaseSensitivity cs, bool regex, const FileSearch::Options& options);
+    void stopRequested();
+
+   private slots:
+    void onBrowseClicked();  // Picks the directory to search
+    void onSearchClicked();  // Starts a search, or stops the running one
+
+   private:
+    QLineEdit* findLineEdit;          // Input field for search term
+    QLineEdit* directoryLineEdit;     // Root of the tree to search
+    QLineEdit* filtersLineEdit;       // File name wildcards; empty searches every file
+    QSpinBox* maxSizeSpinBox;         // Files bigger than this many megabytes are skipped
+    QCheckBox* matchCaseCheckBox;     // Checkbox to toggle case-sensitive search
+    QCheckBox* regexCheckBox;         // Checkbox to treat the term as a regular expression
+    QCheckBox* skipBinaryCheckBox;    // Checkbox to skip files that contain NUL bytes
+    QCheckBox* skipHiddenCheckBox;    // Checkbox to skip hidden files and directories
+    QLabel* statusLabel;              // Progress of the running search
+    QPushButton* searchButton;        // Button to start or stop the search
+    QPushButton* closeButton;         // Button to close the dialog
+    bool running = false;             // A search started from this dialog is still running
+};
+
+#endif  // FINDINFILESDIALOG_H
@@ -1,16 +1,25 @@
 #include "findreplacedialog.h"
+#include "editorwidget.h"
+#include "incrementalsearch.h"
+#include "trace.h"
 #include <QVBoxLayout>
 #include <QPushButton>
 
 FindReplaceDialog::FindReplaceDialog(QWidget* parent) : QDialog(parent) {
     setWindowTitle(tr("Find and Replace"));
 
+    search = new IncrementalSearch(this);
+    connect(search, &IncrementalSearch::matchesChanged, this, &FindReplaceDialog::updateMatchLabel);
+    connect(search, &IncrementalSearch::replaceFinished, this, &FindReplaceDialog::onReplaceAllFinished);
+
     QGridLayout* layout = new QGridLayout(this);
 
     QLabel* findLabel = new QLabel(tr("Find:"));
     layout->addWidget(findLabel, 0, 0);
     findLineEdit = new QLineEdit(this);
     layout->addWidget(findLineEdit, 0, 1);
+    connect(findLineEdit, &QLineEdit::textChanged, this, &FindReplaceDialog::onFindTextChanged);
+    connect(findLineEdit, &QLineEdit::returnPressed, this, &FindReplaceDialog::onFindClicked);
 
     QLabel* replaceLabel = new QLabel(tr("Replace:"));
     layout->addWidget(replaceLabel, 1, 0);
@@ -18,83 +27,185 @@ FindReplaceDialog::FindReplaceDialog(QWidget* parent) : QDialog(parent) {
     layout->addWidget(replaceLineEdit, 1, 1);
 
     matchCaseCheckBox = new QCheckBox(tr("Match case"), this);
-    layout->addWidget(matchCaseCheckBox, 2, 0, 1, 2);
+    layout->addWidget(matchCaseCheckBox, 2, 0);
+    connect(matchCaseCheckBox, &QCheckBox::toggled, this, &FindReplaceDialog::onFindTextChanged);
+
+    regexCheckBox = new QCheckBox(tr("Regular expression"), this);
+    regexCheckBox->setToolTip(tr("In the replacement, \\1 or \\g<name> inserts a captured group"));
+    layout->addWidget(regexCheckBox, 2, 1);
+    connect(regexCheckBox, &QCheckBox::toggled, this, &FindReplaceDialog::onFindTextChanged);
+
+    inSelectionCheckBox = new QCheckBox(tr("In selection"), this);
+    layout->addWidget(inSelectionCheckBox, 3, 0);
+    connect(inSelectionCheckBox, &QCheckBox::toggled, this, &FindReplaceDialog::onInSelectionToggled);
+
+    allTabsCheckBox = new QCheckBox(tr("All open tabs"), this);
+    allTabsCheckBox->setToolTip(tr("Find lists the matches of every tab in the search results panel"));
+    layout->addWidget(allTabsCheckBox, 3, 1);
+    connect(allTabsCheckBox, &QCheckBox::toggled, this, &FindReplaceDialog::onAllTabsToggled);
+
+    matchLabel = new QLabel(this);
+    matchLabel->setAlignment(Qt::AlignRight | Qt::AlignVCenter);
+    layout->addWidget(matchLabel, 4, 0, 1, 2);
 
     findButton = new QPushButton(tr("Find"), this);
-    layout->addWidget(findButton, 3, 0);
+    layout->addWidget(findButton, 5, 0);
     connect(findButton, &QPushButton::clicked, this, &FindReplaceDialog::onFindClicked);
 
+    findPreviousButton = new QPushButton(tr("Previous"), this);
+    layout->addWidget(findPreviousButton, 5, 1);
+    connect(findPreviousButton, &QPushButton::clicked, this, &FindReplaceDialog::onFindPreviousClicked);
+
     replaceButton = new QPushButton(tr("Replace"), this);
-    layout->addWidget(replaceButton, 3, 1);
+    layout->addWidget(replaceButton, 6, 0);
     connect(replaceButton, &QPushButton::clicked, this, &FindReplaceDialog::onReplaceClicked);
 
     replaceAllButton = new QPushButton(tr("Replace All"), this);
-    layout->addWidget(replaceAllButton, 4, 0, 1, 2);
+    layout->addWidget(replaceAllButton, 6, 1);
     connect(replaceAllButton, &QPushButton::clicked, this, &FindReplaceDialog::onReplaceAllClicked);
 
     closeButton = new QPushButton(tr("Close"), this);
-    layout->addWidget(closeButton, 5, 0, 1, 2);
+    layout->addWidget(closeButton, 7, 0, 1, 2);
     connect(closeButton, &QPushButton::clicked, this, &QDialog::accept);
 
     setLayout(layout);
 }
 
-void FindReplaceDialog::setTextEdit(QPlainTextEdit* edit) {
-    textEdit = edit;
+void FindReplaceDialog::setEditor(EditorWidget* ew) {
+    editor = ew;
+    if (isVisible()) {
+        search->setEditor(ew);
+        inSelectionCheckBox->setChecked(false);
+    }
 }
 
-void FindReplaceDialog::onFindClicked() {
-    if (!textEdit)
-        return;
+QPlainTextEdit* FindReplaceDialog::textEdit() const {
+    return editor && !editor->isLargeFileMode() ? editor->textEdit() : nullptr;
+}
 
-    QString findText = findLineEdit->text();
-    QTextDocument::FindFlags flags;
-    if (matchCaseCheckBox->isChecked()) {
-        flags |= QTextDocument::FindCaseSensitively;
-    }
+bool FindReplaceDialog::isReadOnly() const {
+    return editor && editor->isFollowing();
+}
 
-    QTextCursor cursor = textEdit->textCursor();
-    bool found = textEdit->find(findText, flags);
-    if (!found) {
-        QMessageBox::information(this, tr("Find"), tr("Text not found"));
-    }
+void FindReplaceDialog::showEvent(QShowEvent* event) {
+    QDialog::showEvent(event);
+    search->setEditor(editor);
+    onFindTextChanged();
 }
 
-void FindReplaceDialog::onReplaceClicked() {
-    if (!textEdit)
-        return;
+void FindReplaceDialog::hideEvent(QHideEvent* event) {
+    QDialog::hideEvent(event);
+    inSelectionCheckBox->setChecked(false);
+    search->clear();
+    search->setEditor(nullptr);
+}
 
-    QString findText = findLineEdit->text();
-    QString replaceText = replaceLineEdit->text();
-    QTextDocument::FindFlags flags;
-    if (matchCaseCheckBox->isChecked()) {
-        flags |= QTextDocument::FindCaseSensitively;
+void FindReplaceDialog::onFindTextChanged() {
+    TRACE_SCOPE("FindReplaceDialog::onFindTextChanged");
+    replacedCount = -1;
+    replaceDropped = false;
+    search->setPattern(findLineEdit->text(), matchCaseCheckBox->isChecked() ? Qt::CaseSensitive : Qt::CaseInsensitive, regexCheckBox->isChecked());
+}
+
+void FindReplaceDialog::onInSelectionToggled() {
+    QPlainTextEdit* edit = textEdit();
+    replacedCount = -1;
+    replaceDropped = false;
+    search->setScope(inSelectionCheckBox->isChecked() && edit ? edit->textCursor() : QTextCursor());
+}
+
+void FindReplaceDialog::onAllTabsToggled() {
+    // A selection only exists in the current tab
+    const bool allTabs = allTabsCheckBox->isChecked();
+    if (allTabs) {
+        inSelectionCheckBox->setChecked(false);
     }
+    inSelectionCheckBox->setEnabled(!allTabs);
+    findPreviousButton->setEnabled(!allTabs);
+}
 
-    QTextCursor cursor = textEdit->textCursor();
-    bool found = textEdit->find(findText, flags);
-    if (found) {
-        cursor.insertText(replaceText);
+void FindReplaceDialog::updateMatchLabel() {
+    if (replacedCount >= 0) {
+        matchLabel->setText(tr("%n replaced", nullptr, replacedCount));
+    }
+    else if (replaceDropped) {
+        matchLabel->setText(tr("Text changed, nothing replaced"));
+    }
+    else if (search->pattern().isEmpty()) {
+        matchLabel->clear();
+    }
+    else if (!search->errorString().isEmpty()) {
+        matchLabel->setText(tr("Invalid pattern: %1").arg(search->errorString()));
+    }
+    else if (search->isSearching()) {
+        matchLabel->setText(tr("Searching..."));
+    }
+    else if (search->matchCount() == 0) {
+        matchLabel->setText(tr("No matches"));
     }
     else {
-        QMessageBox::information(this, tr("Replace"), tr("Text not found"));
+        const QString total = search->isCapped() ? tr("%1+").arg(search->matchCount()) : QString::number(search->matchCount());
+        const int current = search->currentMatch();
+        matchLabel->setText(current >= 0 ? tr("%1 of %2").arg(current + 1).arg(total) : tr("%1 matches").arg(total));
     }
 }
 
-void FindReplaceDialog::onReplaceAllClicked() {
-    if (!textEdit)
+void FindReplaceDialog::onFindClicked() {
+    TRACE_SCOPE("FindReplaceDialog::onFindClicked");
+    replacedCount = -1;
+    replaceDropped = false;
+    if (allTabsCheckBox->isChecked()) {
+        emit searchInTabsRequested(findLineEdit->text(), matchCaseCheckBox->isChecked() ? Qt::CaseSensitive : Qt::CaseInsensitive, regexCheckBox->isChecked());
         return;
+    }
+    search->findNext();
+}
+
+void FindReplaceDialog::onFindPreviousClicked() {
+    TRACE_SCOPE("FindReplaceDialog::onFindPreviousClicked");
+    replacedCount = -1;
+    replaceDropped = false;
+    search->findPrevious();
+}
 
-    QString findText = findLineEdit->text();
-    QString replaceText = replaceLineEdit->text();
-    QTextDocument::FindFlags flags;
-    if (matchCaseCheckBox->isChecked()) {
-        flags |= QTextDocument::FindCaseSensitively;
+void FindReplaceDialog::onReplaceClicked() {
+    TRACE_SCOPE("FindReplaceDialog::onReplaceClicked");
+    // The first click selects a match, the next replaces it and moves on
+    replacedCount = -1;
+    replaceDropped = false;
+    if (isReadOnly()) {
+        matchLabel->setText(tr("Read-only while following the file"));
+        return;
     }
+    search->replaceCurrent(replaceLineEdit->text());
+    search->findNext();
+}
 
-    QTextCursor cursor = textEdit->textCursor();
-    while (textEdit->find(findText, flags)) {
-        cursor = textEdit->textCursor();
-        cursor.insertText(replaceText);
+void FindReplaceDialog::onReplaceAllClicked() {
+    TRACE_SCOPE("FindReplaceDialog::onReplaceAllClicked");
+    // Matching and rebuilding run on a worker; the result is applied as one edit block
+    if (allTabsCheckBox->isChecked()) {
+        emit replaceInTabsRequested(findLineEdit->text(), matchCaseCheckBox->isChecked() ? Qt::CaseSensitive : Qt::CaseInsensitive, regexCheckBox->isChecked(),
+                                    replaceLineEdit->text());
+        return;
     }
+    replacedCount = -1;
+    replaceDropped = false;
+    if (isReadOnly()) {
+        matchLabel->setText(tr("Read-only while following the file"));
+        return;
+    }
+    replaceAllButton->setEnabled(false);
+    search->replaceAll(replaceLineEdit->text());
+    if (!search->isReplacing()) {
+        replaceAllButton->setEnabled(true);
+    }
+}
+
+void FindReplaceDialog::onReplaceAllFinished(int count) {
+    TRACE_SCOPE("FindReplaceDialog::onReplaceAllFinished");
+    replaceAllButton->setEnabled(true);
+    replacedCount = count;
+    replaceDropped = count < 0;
+    updateMatchLabel();
 }
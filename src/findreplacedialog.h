@@ -11,6 +11,10 @@
 #include <QTextDocument>
 #include <QMessageBox>
 #include <QGridLayout>
+#include <QPointer>
+
+class EditorWidget;
+class IncrementalSearch;
 
 class FindReplaceDialog : public QDialog {
     Q_OBJECT
@@ -18,22 +22,48 @@ class FindReplaceDialog : public QDialog {
    public:
     explicit FindReplaceDialog(QWidget* parent = nullptr);  // Constructor sets up UI components and layout
 
-    void setTextEdit(QPlainTextEdit* edit);  // Sets the text editor where Find/Replace will occur
+    void setEditor(EditorWidget* editor);  // Sets the editor where Find/Replace will occur
+
+   signals:
+    // Emitted instead of searching the current editor while "All open tabs" is checked
+    void searchInTabsRequested(const QString& pattern, Qt::CaseSensitivity cs, bool regex);
+    void replaceInTabsRequested(const QString& pattern, Qt::CaseSensitivity cs, bool regex, const QString& replacement);
+
+   protected:
+    void showEvent(QShowEvent* event) override;  // Searches for the current term again
+    void hideEvent(QHideEvent* event) override;  // Removes the match highlights from the editor
 
    private slots:
-    void onFindClicked();        // Handles the "Find" button click event
-    void onReplaceClicked();     // Handles the "Replace" button click event
-    void onReplaceAllClicked();  // Handles the "Replace All" button click event
+    void onFindTextChanged();              // Searches as the term or an option changes
+    void onInSelectionToggled();           // Limits the search to the current selection
+    void onAllTabsToggled();               // Switches Find and Replace All to every open tab
+    void onFindClicked();                  // Handles the "Find" button click event
+    void onFindPreviousClicked();          // Handles the "Previous" button click event
+    void onReplaceClicked();               // Handles the "Replace" button click event
+    void onReplaceAllClicked();            // Handles the "Replace All" button click event
+    void onReplaceAllFinished(int count);  // Shows how many matches Replace All changed
+    void updateMatchLabel();               // Shows "N of M" for the current match
 
    private:
-    QLineEdit* findLineEdit;        // Input field for search term
-    QLineEdit* replaceLineEdit;     // Input field for replacement term
-    QCheckBox* matchCaseCheckBox;   // Checkbox to toggle case-sensitive search
-    QPushButton* findButton;        // Button to trigger "Find"
-    QPushButton* replaceButton;     // Button to trigger "Replace"
-    QPushButton* replaceAllButton;  // Button to trigger "Replace All"
-    QPushButton* closeButton;       // Button to close the dialog
-    QPlainTextEdit* textEdit;       // The text editor to perform find/replace operations on
+    QPlainTextEdit* textEdit() const;  // The text editor to perform find/replace operations on
+    bool isReadOnly() const;           // The tab follows its file, so it can be searched but not replaced in
+
+    QLineEdit* findLineEdit;          // Input field for search term
+    QLineEdit* replaceLineEdit;       // Input field for replacement term
+    QCheckBox* matchCaseCheckBox;     // Checkbox to toggle case-sensitive search
+    QCheckBox* regexCheckBox;         // Checkbox to treat the term as a regular expression
+    QCheckBox* inSelectionCheckBox;   // Checkbox to search only the selection made before it was checked
+    QCheckBox* allTabsCheckBox;       // Checkbox to find and replace in every open tab, listing the results
+    QLabel* matchLabel;               // Match count and index of the current match
+    QPushButton* findButton;          // Button to trigger "Find"
+    QPushButton* findPreviousButton;  // Button to find the previous match
+    QPushButton* replaceButton;       // Button to trigger "Replace"
+    QPushButton* replaceAllButton;    // Button to trigger "Replace All"
+    QPushButton* closeButton;         // Button to close the dialog
+    QPointer<EditorWidget> editor;    // The editor Find/Replace works on
+    IncrementalSearch* search;        // Find-as-you-type state and match highlights
+    int replacedCount = -1;           // Matches changed by the last Replace All, shown until the next search
+    bool replaceDropped = false;      // The last Replace All was dropped because the text changed
 };
 
 #endif  // FINDREPLACEDIALOG_H
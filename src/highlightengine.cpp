@@ -0,0 +1,62 @@
+#include "highlightengine.h"
+#include "trace.h"
+#include <QCoreApplication>
+#include <QThreadPool>
+#include <atomic>
+
+struct HighlightEngine::State {
+    std::atomic<bool> cancelled{false};
+    HighlightEngine* owner = nullptr;  // Only touched on the GUI thread
+};
+
+HighlightEngine::HighlightEngine(Tokenizer tokenizer, QObject* parent) : QObject(parent), m_tokenizer(tokenizer) {
+    m_state = std::make_shared<State>();
+    m_state->owner = this;
+}
+
+HighlightEngine::~HighlightEngine() {
+    m_state->cancelled = true;
+    m_state->owner = nullptr;
+}
+
+void HighlightEngine::submit(quint64 revision, int firstBlock, int inputState, const QStringList& texts) {
+    std::shared_ptr<State> state = m_state;
+    Tokenizer tokenize = m_tokenizer;
+    m_busy = true;
+
+    QThreadPool::globalInstance()->start([state, tokenize, revision, firstBlock, inputState, texts]() {
+        TRACE_SCOPE("HighlightEngine tokenize");
+        auto result = std::make_shared<Result>();
+        result->revision = revision;
+        result->firstBlock = firstBlock;
+        result->inputState = inputState;
+        result->endStates.reserve(texts.size());
+        result->spanStarts.reserve(texts.size() + 1);
+
+        QVector<HighlightSpan> lineSpans;
+        int blockState = inputState;
+        for (const QString& text : texts) {
+            if (state->cancelled) {
+                return;
+            }
+            blockState = tokenize(text, blockState, lineSpans);
+            result->spanStarts.append(result->spans.size());
+            result->spans.append(lineSpans);
+            result->endStates.append(blockState);
+        }
+        result->spanStarts.append(result->spans.size());
+
+        std::weak_ptr<State> weak = state;
+        std::shared_ptr<const Result> finished = std::move(result);
+        QMetaObject::invokeMethod(
+            QCoreApplication::instance(),
+            [weak, finished]() {
+                std::shared_ptr<State> s = weak.lock();
+                if (s && s->owner) {
+                    s->owner->m_busy = false;
+                    emit s->owner->resultReady(finished);
+                }
+            },
+            Qt::QueuedConnection);
+    });
+}
@@ -0,0 +1,64 @@
+#ifndef HIGHLIGHTENGINE_H
+#define HIGHLIGHTENGINE_H
+
+#include <QObject>
+#include <QStringList>
+#include <QVector>
+#include <memory>
+
+#include "language_support.h"
+
+/**
+ * @brief The HighlightEngine class
+ *        Tokenizes snapshots of consecutive blocks on the global thread pool. Each
+ *        result is tagged with the document revision the snapshot was taken at, so
+ *        the GUI thread can drop results that an edit has made stale and only ever
+ *        applies ranges that were computed for the text it is showing.
+ */
+class HighlightEngine : public QObject {
+    Q_OBJECT
+
+   public:
+    // A pure lexer such as CxxSyntaxHighlighter::tokenize
+    using Tokenizer = HighlightRules::Tokenizer;
+
+    // The spans and end states of one snapshot, indexed by block number
+    struct Result {
+        quint64 revision = 0;
+        int firstBlock = 0;
+        int inputState = -1;      // State the snapshot was tokenized from, i.e. the end state of firstBlock - 1
+        QVector<int> endStates;   // End state of every block
+        QVector<int> spanStarts;  // Index of every block's first span in spans, plus one past the last
+        QVector<HighlightSpan> spans;
+
+        int lastBlock() const { return firstBlock + endStates.size() - 1; }
+        bool covers(int blockNumber) const { return blockNumber >= firstBlock && blockNumber <= lastBlock(); }
+        int inputStateOf(int blockNumber) const { return blockNumber == firstBlock ? inputState : endStates[blockNumber - firstBlock - 1]; }
+    };
+
+    explicit HighlightEngine(Tokenizer tokenizer, QObject* parent = nullptr);
+    ~HighlightEngine() override;  // Drops the result of a job that is still running
+
+    /**
+     * @brief Tokenizes a snapshot of blocks on a worker thread.
+     * @param revision The document revision the texts were taken at.
+     * @param firstBlock Block number of the first text.
+     * @param inputState The state the block before firstBlock ended in.
+     * @param texts The text of each block; the worker only holds this copy.
+     */
+    void submit(quint64 revision, int firstBlock, int inputState, const QStringList& texts);
+
+    bool isBusy() const { return m_busy; }  // True while a submitted snapshot has not come back yet
+
+   signals:
+    void resultReady(const std::shared_ptr<const HighlightEngine::Result>& result);
+
+   private:
+    struct State;  // Shared with the worker so it outlives an engine deleted mid-job
+
+    Tokenizer m_tokenizer;
+    std::shared_ptr<State> m_state;
+    bool m_busy = false;
+};
+
+#endif  // HIGHLIGHTENGINE_H
@@ -0,0 +1,322 @@
+#include "highlightscheduler.h"
+#include "editorwidget.h"
+#include "incrementalhighlighter.h"
+#include "trace.h"
+#include <QTextDocument>
+#include <algorithm>
+#include <utility>
+
+HighlightScheduler::HighlightScheduler(MyPlainTextEdit* edit, QObject* parent) : QObject(parent), m_edit(edit) {
+    m_sliceTimer.setSingleShot(true);
+    connect(&m_sliceTimer, &QTimer::timeout, this, &HighlightScheduler::runSlice);
+
+    // Connected before any highlighter attaches, so this runs ahead of QSyntaxHighlighter's own pass
+    connect(m_edit->document(), &QTextDocument::contentsChange, this, &HighlightScheduler::onContentsChange);
+    connect(m_edit, &QPlainTextEdit::updateRequest, this, [this](const QRect&, int) { highlightViewport(); });
+}
+
+void HighlightScheduler::setHighlighter(QSyntaxHighlighter* highlighter) {
+    m_highlighter = highlighter;
+    m_pending.clear();
+    m_results.clear();
+    m_lastDeferred = -2;
+
+    delete m_engine;
+    m_engine = nullptr;
+    if (auto incremental = qobject_cast<IncrementalHighlighter*>(highlighter)) {
+        incremental->setScheduler(this);
+        if (HighlightEngine::Tokenizer tokenizer = incremental->tokenizer()) {
+            m_engine = new HighlightEngine(tokenizer, this);
+            connect(m_engine, &HighlightEngine::resultReady, this, &HighlightScheduler::onResultReady);
+        }
+    }
+    if (!highlighter) {
+        m_sliceTimer.stop();
+        return;
+    }
+
+    QTextDocument* doc = m_edit->document();
+    m_pending.append({QTextCursor(doc->begin()), QTextCursor(doc->lastBlock())});
+    highlightViewport();
+    m_sliceTimer.start(0);
+}
+
+bool HighlightScheduler::shouldDefer(const QTextBlock& block) {
+    const int number = block.blockNumber();
+    const bool inBudget = m_inSlice && m_sliceClock.elapsed() < SliceBudgetMs;
+    if ((number >= m_visibleFirst && number <= m_visibleLast) || (inBudget && (!m_engine || findResult(number, block.previous().userState())))) {
+        m_lastHighlighted = number;
+        return false;
+    }
+
+    postpone(block, number);
+    return true;
+}
+
+void HighlightScheduler::updateVisibleRange() {
+    const int lineHeight = qMax(1, m_edit->fontMetrics().height());
+    m_visibleFirst = m_edit->firstVisibleBlock().blockNumber();
+    m_visibleLast = m_visibleFirst + m_edit->viewport()->height() / lineHeight + ViewportMargin;
+}
+
+void HighlightScheduler::highlightViewport() {
+    if (!m_highlighter || m_applying) {
+        return;
+    }
+    updateVisibleRange();
+    normalizePending();
+
+    // Never-highlighted and queued blocks in view jump the queue; they are highlighted
+    // against the state of the block above them even if that one is still queued
+    QTextBlock block = m_edit->firstVisibleBlock();
+    while (block.isValid() && block.blockNumber() <= m_visibleLast) {
+        const int number = block.blockNumber();
+        if (block.userState() == -1 || isPending(number)) {
+            rehighlight(block);
+            block = m_edit->document()->findBlockByNumber(qMax(number, m_lastHighlighted) + 1);
+        }
+        else {
+            block = block.next();
+        }
+    }
+}
+
+void HighlightScheduler::runSlice() {
+    TRACE_SCOPE("HighlightScheduler::runSlice");
+    if (!m_highlighter) {
+        m_pending.clear();
+        return;
+    }
+
+    updateVisibleRange();
+    normalizePending();
+
+    QList<PendingRange> work;
+    work.swap(m_pending);
+
+    m_inSlice = true;
+    m_lastDeferred = -2;
+    m_sliceClock.start();
+    const bool outOfTime = m_engine ? applyResults(work) : highlightSlice(work);
+    m_inSlice = false;
+
+    // Unfinished ranges go back ahead of anything postponed during this slice
+    work.append(m_pending);
+    m_pending.swap(work);
+
+    if (m_engine) {
+        // Without a result to apply the next slice waits for the worker instead of polling
+        normalizePending();
+        pruneResults();
+        requestTokens();
+        if (outOfTime) {
+            m_sliceTimer.start(0);
+        }
+    }
+    else if (!m_pending.isEmpty()) {
+        m_sliceTimer.start(0);
+    }
+}
+
+bool HighlightScheduler::highlightSlice(QList<PendingRange>& work) {
+    QTextDocument* doc = m_edit->document();
+
+    int done = 0;
+    for (; done < work.size() && m_sliceClock.elapsed() < SliceBudgetMs; ++done) {
+        PendingRange& range = work[done];
+        const int lastNumber = range.last.blockNumber();
+        QTextBlock block = range.first.block();
+
+        while (block.isValid() && block.blockNumber() <= lastNumber && m_sliceClock.elapsed() < SliceBudgetMs) {
+            rehighlight(block);
+            block = doc->findBlockByNumber(qMax(block.blockNumber(), m_lastHighlighted) + 1);
+        }
+
+        if (block.isValid() && block.blockNumber() <= lastNumber) {
+            range.first = QTextCursor(block);
+            break;
+        }
+    }
+
+    work.remove(0, done);
+    return !work.isEmpty();
+}
+
+bool HighlightScheduler::applyResults(QList<PendingRange>& work) {
+    QTextDocument* doc = m_edit->document();
+    QList<PendingRange> rest;
+    bool outOfTime = false;
+
+    for (const PendingRange& range : std::as_const(work)) {
+        const int lastNumber = range.last.blockNumber();
+        QTextBlock block = range.first.block();
+
+        // Stops at the first block no current result was computed for; it stays queued for the worker
+        while (!outOfTime && block.isValid() && block.blockNumber() <= lastNumber) {
+            if (m_sliceClock.elapsed() >= SliceBudgetMs) {
+                outOfTime = true;
+            }
+            else if (!findResult(block.blockNumber(), block.previous().userState())) {
+                break;
+            }
+            else {
+                rehighlight(block);
+                block = doc->findBlockByNumber(qMax(block.blockNumber(), m_lastHighlighted) + 1);
+            }
+        }
+
+        if (block.isValid() && block.blockNumber() <= lastNumber) {
+            rest.append({QTextCursor(block), range.last});
+        }
+    }
+
+    work.swap(rest);
+    return outOfTime;
+}
+
+void HighlightScheduler::requestTokens() {
+    if (m_engine->isBusy()) {
+        return;
+    }
+
+    QTextDocument* doc = m_edit->document();
+    for (const PendingRange& range : std::as_const(m_pending)) {
+        const int lastNumber = range.last.blockNumber();
+        QTextBlock block = range.first.block();
+        int inputState = block.previous().userState();
+
+        // Blocks covered by results are skipped; the end state of a result predicts the input of the next snapshot
+        while (block.isValid() && block.blockNumber() <= lastNumber) {
+            const HighlightEngine::Result* result = findResult(block.blockNumber(), inputState);
+            if (!result) {
+                break;
+            }
+            inputState = result->endStates.last();
+            block = doc->findBlockByNumber(result->lastBlock() + 1);
+        }
+        if (!block.isValid() || block.blockNumber() > lastNumber) {
+            continue;
+        }
+
+        const int firstNumber = block.blockNumber();
+        QStringList texts;
+        for (; block.isValid() && block.blockNumber() <= lastNumber && texts.size() < SnapshotBlocks; block = block.next()) {
+            texts.append(block.text());
+        }
+        m_engine->submit(m_revision, firstNumber, inputState, texts);
+        return;
+    }
+}
+
+void HighlightScheduler::onResultReady(const std::shared_ptr<const HighlightEngine::Result>& result) {
+    // A stale result is dropped; the next slice snapshots the edited text again
+    if (result->revision == m_revision) {
+        m_results.append(result);
+    }
+    if (!m_sliceTimer.isActive()) {
+        m_sliceTimer.start(0);
+    }
+}
+
+const HighlightEngine::Result* HighlightScheduler::findResult(int blockNumber, int previousState) const {
+    for (const std::shared_ptr<const HighlightEngine::Result>& result : m_results) {
+        if (result->covers(blockNumber) && result->inputStateOf(blockNumber) == previousState) {
+            return result.get();
+        }
+    }
+    return nullptr;
+}
+
+bool HighlightScheduler::precomputed(const QTextBlock& block, int previousState, QVector<HighlightSpan>& spans, int* state) const {
+    const int number = block.blockNumber();
+    const HighlightEngine::Result* result = findResult(number, previousState);
+    if (!result) {
+        return false;
+    }
+
+    const int index = number - result->firstBlock;
+    const int first = result->spanStarts[index];
+    spans.resize(result->spanStarts[index + 1] - first);
+    std::copy_n(result->spans.constBegin() + first, spans.size(), spans.begin());
+    *state = result->endStates[index];
+    return true;
+}
+
+void HighlightScheduler::pruneResults() {
+    auto unused = [this](const std::shared_ptr<const HighlightEngine::Result>& result) {
+        for (const PendingRange& range : std::as_const(m_pending)) {
+            if (result->firstBlock <= range.last.blockNumber() && result->lastBlock() >= range.first.blockNumber()) {
+                return false;
+            }
+        }
+        return true;
+    };
+    m_results.erase(std::remove_if(m_results.begin(), m_results.end(), unused), m_results.end());
+}
+
+void HighlightScheduler::onContentsChange(int, int charsRemoved, int charsAdded) {
+    // Formats applied by a highlighter's own pass come through here too, as a change that adds no undo step
+    QTextDocument* doc = m_edit->document();
+    const QPair<int, int> steps(doc->availableUndoSteps(), doc->availableRedoSteps());
+    const bool formatsOnly = charsRemoved == charsAdded && steps == m_undoSteps;
+    m_undoSteps = steps;
+    if (m_applying || formatsOnly) {
+        return;
+    }
+
+    // A new edit starts a new pass and makes every worker result stale; background work resumes once typing pauses
+    ++m_revision;
+    m_results.clear();
+    m_lastDeferred = -2;
+    if (m_highlighter) {
+        updateVisibleRange();
+        m_sliceTimer.start(TypingPauseMs);
+    }
+}
+
+void HighlightScheduler::postpone(const QTextBlock& block, int blockNumber) {
+    if (blockNumber == m_lastDeferred + 1 && !m_pending.isEmpty()) {
+        m_pending.last().last = QTextCursor(block);
+    }
+    else if (blockNumber != m_lastDeferred) {
+        m_pending.append({QTextCursor(block), QTextCursor(block)});
+    }
+    m_lastDeferred = blockNumber;
+
+    if (!m_sliceTimer.isActive()) {
+        m_sliceTimer.start(0);
+    }
+}
+
+void HighlightScheduler::normalizePending() {
+    std::sort(m_pending.begin(), m_pending.end(), [](const PendingRange& a, const PendingRange& b) { return a.first.position() < b.first.position(); });
+
+    QList<PendingRange> merged;
+    for (const PendingRange& range : m_pending) {
+        if (!merged.isEmpty() && range.first.blockNumber() <= merged.last().last.blockNumber() + 1) {
+            if (range.last.position() > merged.last().last.position()) {
+                merged.last().last = range.last;
+            }
+        }
+        else {
+            merged.append(range);
+        }
+    }
+    m_pending.swap(merged);
+}
+
+bool HighlightScheduler::isPending(int blockNumber) const {
+    for (const PendingRange& range : m_pending) {
+        if (blockNumber >= range.first.blockNumber() && blockNumber <= range.last.blockNumber()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void HighlightScheduler::rehighlight(const QTextBlock& block) {
+    m_applying = true;
+    m_lastHighlighted = -1;
+    m_highlighter->rehighlightBlock(block);
+    m_applying = false;
+}
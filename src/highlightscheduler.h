@@ -0,0 +1,105 @@
+#ifndef HIGHLIGHTSCHEDULER_H
+#define HIGHLIGHTSCHEDULER_H
+
+#include <QElapsedTimer>
+#include <QList>
+#include <QObject>
+#include <QPair>
+#include <QPointer>
+#include <QSyntaxHighlighter>
+#include <QTextBlock>
+#include <QTextCursor>
+#include <QTimer>
+#include <memory>
+
+#include "highlightengine.h"
+
+class MyPlainTextEdit;
+
+/**
+ * @brief The HighlightScheduler class
+ *        Decides when each block of an editor gets highlighted. Blocks in the viewport
+ *        are highlighted immediately; everything else is queued and worked through in
+ *        short slices while the event loop is idle, so neither opening a big file nor
+ *        typing into one waits for the whole document to be highlighted. When the
+ *        highlighter provides a tokenizer, queued blocks are tokenized on a worker
+ *        thread and the slices only apply the precomputed spans.
+ */
+class HighlightScheduler : public QObject {
+    Q_OBJECT
+
+   public:
+    explicit HighlightScheduler(MyPlainTextEdit* edit, QObject* parent = nullptr);
+
+    /**
+     * @brief Attaches the editor's highlighter and queues the whole document.
+     *        The visible blocks are highlighted before this returns.
+     */
+    void setHighlighter(QSyntaxHighlighter* highlighter);
+    QSyntaxHighlighter* highlighter() const { return m_highlighter; }
+
+    /**
+     * @brief Called by IncrementalHighlighter for every block it is asked to highlight.
+     * @return true if the block was queued for later instead.
+     */
+    bool shouldDefer(const QTextBlock& block);
+
+    /**
+     * @brief Looks up worker-computed spans for a block of the current document revision.
+     * @param previousState The state the block above actually ended in.
+     * @return false if no current result starts from that state.
+     */
+    bool precomputed(const QTextBlock& block, int previousState, QVector<HighlightSpan>& spans, int* state) const;
+
+    // True while the scheduler itself is re-applying formats, which also emits QTextDocument::contentsChange
+    bool isApplyingFormats() const { return m_applying; }
+
+    // Bumped by every edit of the document, but not by format changes; tells whether a text snapshot is still current
+    quint64 revision() const { return m_revision; }
+
+    static constexpr int SliceBudgetMs = 4;      // Longest run of background highlighting per event loop pass
+    static constexpr int TypingPauseMs = 50;     // Background highlighting waits this long after an edit
+    static constexpr int ViewportMargin = 5;     // Blocks past the bottom of the viewport highlighted eagerly
+    static constexpr int SnapshotBlocks = 2000;  // Most blocks handed to the worker in one snapshot
+
+   private:
+    // A run of blocks whose highlighting was postponed, tracked by cursors so edits keep it in place
+    struct PendingRange {
+        QTextCursor first;
+        QTextCursor last;
+    };
+
+    void updateVisibleRange();
+    void highlightViewport();
+    void runSlice();
+    bool highlightSlice(QList<PendingRange>& work);  // Tokenizes queued blocks on this thread
+    bool applyResults(QList<PendingRange>& work);    // Applies worker results to queued blocks
+    void requestTokens();                            // Snapshots the next queued blocks for the worker
+    void onResultReady(const std::shared_ptr<const HighlightEngine::Result>& result);
+    const HighlightEngine::Result* findResult(int blockNumber, int previousState) const;
+    void pruneResults();  // Drops results that no queued block needs any more
+    void onContentsChange(int from, int charsRemoved, int charsAdded);
+    void postpone(const QTextBlock& block, int blockNumber);
+    void normalizePending();  // Sorts the queue and merges overlapping ranges
+    bool isPending(int blockNumber) const;
+    void rehighlight(const QTextBlock& block);
+
+    MyPlainTextEdit* m_edit;
+    QPointer<QSyntaxHighlighter> m_highlighter;
+    QTimer m_sliceTimer;
+    QElapsedTimer m_sliceClock;
+    QList<PendingRange> m_pending;
+    HighlightEngine* m_engine = nullptr;
+    QList<std::shared_ptr<const HighlightEngine::Result>> m_results;  // Only ever holds results of m_revision
+    quint64 m_revision = 0;                                            // Bumped by every edit of the document
+    QPair<int, int> m_undoSteps{-1, -1};                               // Undo and redo steps of the document at the last change seen
+
+    int m_visibleFirst = 0;      // First block number highlighted without deferral
+    int m_visibleLast = -1;      // Last block number highlighted without deferral
+    int m_lastDeferred = -2;     // Block postponed last during the current pass, used to grow ranges
+    int m_lastHighlighted = -1;  // Block highlighted last during the current rehighlight() call
+    bool m_inSlice = false;
+    bool m_applying = false;
+};
+
+#endif  // HIGHLIGHTSCHEDULER_H
@@ -0,0 +1,31 @@
+#include "incrementalhighlighter.h"
+#include "highlightscheduler.h"
+#include <QTextBlock>
+#include <QTextLayout>
+
+void IncrementalHighlighter::setScheduler(HighlightScheduler* scheduler) {
+    m_scheduler = scheduler;
+}
+
+HighlightScheduler* IncrementalHighlighter::scheduler() const {
+    return m_scheduler;
+}
+
+bool IncrementalHighlighter::deferCurrentBlock() {
+    if (!m_scheduler || !m_scheduler->shouldDefer(currentBlock())) {
+        return false;
+    }
+
+    // QSyntaxHighlighter clears the block's formats before calling highlightBlock(), so put the old ones back
+    const QTextBlock block = currentBlock();
+    if (const QTextLayout* layout = block.layout()) {
+        for (const QTextLayout::FormatRange& range : layout->formats()) {
+            setFormat(range.start, range.length, range.format);
+        }
+    }
+    return true;
+}
+
+bool IncrementalHighlighter::takePrecomputed(QVector<HighlightSpan>& spans, int* state) const {
+    return m_scheduler && m_scheduler->precomputed(currentBlock(), previousBlockState(), spans, state);
+}
@@ -0,0 +1,53 @@
+#ifndef INCREMENTALHIGHLIGHTER_H
+#define INCREMENTALHIGHLIGHTER_H
+
+#include <QPointer>
+#include <QSyntaxHighlighter>
+
+#include "highlightengine.h"
+
+class HighlightScheduler;
+
+/**
+ * @brief The IncrementalHighlighter class
+ *        Base class for highlighters driven by a HighlightScheduler. Subclasses call
+ *        deferCurrentBlock() at the top of highlightBlock() so that blocks outside the
+ *        viewport are left for the scheduler's idle-time slices. Subclasses that also
+ *        return a tokenizer() get those blocks tokenized on worker threads instead.
+ */
+class IncrementalHighlighter : public QSyntaxHighlighter {
+    Q_OBJECT
+
+   public:
+    explicit IncrementalHighlighter(QTextDocument* parent = nullptr) : QSyntaxHighlighter(parent) {}
+
+    void setScheduler(HighlightScheduler* scheduler);
+    HighlightScheduler* scheduler() const;
+
+    // The lexer the scheduler runs off the GUI thread; nullptr keeps all highlighting in highlightBlock()
+    virtual HighlightEngine::Tokenizer tokenizer() const { return nullptr; }
+
+   protected:
+    /**
+     * @brief Asks the scheduler whether the current block may be highlighted now.
+     *        A postponed block keeps its previous formats and state, which also ends
+     *        QSyntaxHighlighter's cascade into the following blocks.
+     * @return true if the block was postponed and highlightBlock() should return.
+     */
+    bool deferCurrentBlock();
+
+    /**
+     * @brief Fetches the spans a worker thread already computed for the current block.
+     *        They are only handed out if they were computed for the current document
+     *        revision and from the state the previous block actually ended in.
+     * @param spans Receives the block's spans.
+     * @param state Receives the state the block ends in.
+     * @return true if spans and state were filled in and the block need not be tokenized.
+     */
+    bool takePrecomputed(QVector<HighlightSpan>& spans, int* state) const;
+
+   private:
+    QPointer<HighlightScheduler> m_scheduler;  // Scheduler of the editor this highlighter belongs to
+};
+
+#endif  // INCREMENTALHIGHLIGHTER_H
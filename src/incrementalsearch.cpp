@@ -0,0 +1,523 @@
+#include "incrementalsearch.h"
+#include "editorwidget.h"
+#include "highlightscheduler.h"
+#include "textsearch.h"
+#include "trace.h"
+#include <QColor>
+#include <QCoreApplication>
+#include <QPlainTextEdit>
+#include <QTextDocument>
+#include <QThreadPool>
+#include <algorithm>
+
+struct IncrementalSearch::State {
+    IncrementalSearch* owner = nullptr;  // Only touched on the GUI thread
+};
+
+IncrementalSearch::IncrementalSearch(QObject* parent) : QObject(parent) {
+    m_state = std::make_shared<State>();
+    m_state->owner = this;
+
+    m_researchTimer.setSingleShot(true);
+    connect(&m_researchTimer, &QTimer::timeout, this, &IncrementalSearch::startSearch);
+}
+
+IncrementalSearch::~IncrementalSearch() {
+    if (m_job) {
+        *m_job = true;
+    }
+    if (m_replaceJob) {
+        *m_replaceJob = true;
+    }
+    m_state->owner = nullptr;
+}
+
+QPlainTextEdit* IncrementalSearch::textEdit() const {
+    return m_editor && !m_editor->isLargeFileMode() ? m_editor->textEdit() : nullptr;
+}
+
+void IncrementalSearch::setEditor(EditorWidget* editor) {
+    if (m_editor == editor) {
+        return;
+    }
+
+    if (QPlainTextEdit* edit = textEdit()) {
+        if (m_hasHighlights) {
+            edit->setExtraSelections({});
+        }
+        disconnect(edit, nullptr, this, nullptr);
+        disconnect(edit->document(), nullptr, this, nullptr);
+    }
+
+    m_editor = editor;
+    m_scheduler = editor ? editor->highlightScheduler() : nullptr;
+    m_text = QString();
+    m_folded = QString();
+    m_matches.clear();
+    m_lengths.clear();
+    m_matchedPattern.clear();
+    m_scope = QTextCursor();
+    m_hasHighlights = false;
+    m_selectOnResult = false;
+
+    if (QPlainTextEdit* edit = textEdit()) {
+        connect(edit->document(), &QTextDocument::contentsChange, this, &IncrementalSearch::onContentsChange);
+        connect(edit, &QPlainTextEdit::updateRequest, this, [this]() { updateHighlights(); });
+        connect(edit, &QPlainTextEdit::cursorPositionChanged, this, &IncrementalSearch::matchesChanged);
+    }
+    startSearch();
+}
+
+void IncrementalSearch::setPattern(const QString& pattern, Qt::CaseSensitivity cs, bool regex) {
+    m_pattern = pattern;
+    m_cs = cs;
+    m_regex = regex;
+    m_selectOnResult = true;
+    if (QPlainTextEdit* edit = textEdit()) {
+        m_anchor = edit->textCursor().selectionStart();
+    }
+    startSearch();
+}
+
+void IncrementalSearch::setScope(const QTextCursor& selection) {
+    m_scope = selection.hasSelection() ? selection : QTextCursor();
+    m_matchedPattern.clear();
+    m_selectOnResult = false;
+    startSearch();
+}
+
+void IncrementalSearch::clear() {
+    m_pattern.clear();
+    m_scope = QTextCursor();
+    m_selectOnResult = false;
+    startSearch();
+}
+
+void IncrementalSearch::takeSnapshot() {
+    if (!m_text.isNull()) {
+        return;
+    }
+
+    // Raw text keeps non-breaking spaces, so Replace All never flattens them; offsets match document positions
+    m_text = textEdit()->document()->toRawText();
+    if (m_text.isNull()) {
+        m_text = QLatin1String("");  // Null marks a missing snapshot, so an empty document needs an empty string
+    }
+    m_folded = QString();
+    m_matches.clear();
+    m_lengths.clear();
+    m_matchedPattern.clear();
+}
+
+void IncrementalSearch::scopeRange(int* start, int* end) const {
+    *start = 0;
+    *end = static_cast<int>(m_text.size());
+    if (!m_scope.isNull()) {
+        *start = qMin(m_scope.selectionStart(), *end);
+        *end = qMin(m_scope.selectionEnd(), *end);
+    }
+}
+
+void IncrementalSearch::startSearch() {
+    if (m_job) {
+        *m_job = true;
+        m_job.reset();
+    }
+    ++m_generation;
+    m_researchTimer.stop();
+    m_error.clear();
+
+    QPlainTextEdit* edit = textEdit();
+    if (m_pattern.isEmpty() || !edit) {
+        m_matches.clear();
+        m_lengths.clear();
+        m_matchedPattern.clear();
+        m_searching = false;
+        updateHighlights(true);
+        emit matchesChanged();
+        return;
+    }
+
+    takeSnapshot();
+
+    const Qt::CaseSensitivity cs = m_cs;
+    const bool regex = m_regex;
+    QRegularExpression re;
+    if (regex) {
+        re = TextSearch::regex(m_pattern, cs);
+        if (!re.isValid()) {
+            m_error = re.errorString();
+            m_matches.clear();
+            m_lengths.clear();
+            m_matchedPattern.clear();
+            m_searching = false;
+            updateHighlights(true);
+            emit matchesChanged();
+            return;
+        }
+    }
+
+    const QString needle = cs == Qt::CaseSensitive || regex ? m_pattern : TextSearch::fold(m_pattern);
+    const bool sameSearch = !m_matchedPattern.isEmpty() && m_matchedCs == cs && m_matchedRegex == regex;
+
+    if (sameSearch && needle == m_matchedPattern) {
+        onResult(m_generation, needle, m_matches, m_lengths, QString());
+        return;
+    }
+
+    // A literal pattern that extends the previous one only needs the previous matches checked again
+    QVector<int> candidates;
+    const bool narrowing = sameSearch && !regex && !isCapped() && needle.startsWith(m_matchedPattern);
+    if (narrowing) {
+        candidates = m_matches;
+    }
+
+    auto cancelled = std::make_shared<std::atomic<bool>>(false);
+    m_job = cancelled;
+    m_searching = true;
+
+    std::shared_ptr<State> state = m_state;
+    const quint64 generation = m_generation;
+    const QString text = m_text;
+    const QString folded = m_folded;
+    int scopeStart = 0;
+    int scopeEnd = 0;
+    scopeRange(&scopeStart, &scopeEnd);
+
+    QThreadPool::globalInstance()->start([state, cancelled, generation, text, folded, cs, regex, re, needle, narrowing, candidates, scopeStart, scopeEnd]() {
+        TRACE_SCOPE("IncrementalSearch search");
+        QString newFolded;
+        QVector<int> matches;
+        QVector<int> lengths;
+
+        if (regex) {
+            TextSearch::findAll(TextSearch::withLineBreaks(text), re, scopeStart, scopeEnd, MaxMatches, matches, lengths, cancelled.get());
+        }
+        else {
+            if (cs == Qt::CaseInsensitive && folded.isNull()) {
+                newFolded = TextSearch::fold(text);
+            }
+            const QStringView haystack = cs == Qt::CaseSensitive ? QStringView(text) : QStringView(folded.isNull() ? newFolded : folded);
+            if (narrowing) {
+                matches = TextSearch::narrow(haystack, needle, candidates, cancelled.get());
+            }
+            else {
+                matches = TextSearch::findAll(haystack.sliced(scopeStart, scopeEnd - scopeStart), needle, MaxMatches, cancelled.get());
+                for (int& match : matches) {
+                    match += scopeStart;
+                }
+            }
+        }
+        if (*cancelled) {
+            return;
+        }
+
+        std::weak_ptr<State> weak = state;
+        QMetaObject::invokeMethod(
+            QCoreApplication::instance(),
+            [weak, generation, needle, matches, lengths, newFolded]() {
+                std::shared_ptr<State> s = weak.lock();
+                if (s && s->owner) {
+                    s->owner->onResult(generation, needle, matches, lengths, newFolded);
+                }
+            },
+            Qt::QueuedConnection);
+    });
+
+    emit matchesChanged();
+}
+
+void IncrementalSearch::onResult(quint64 generation, const QString& needle, const QVector<int>& matches, const QVector<int>& lengths, const QString& folded) {
+    if (generation != m_generation) {
+        return;
+    }
+
+    if (!folded.isNull()) {
+        m_folded = folded;
+    }
+    m_job.reset();
+    m_searching = false;
+    m_matches = matches;
+    m_lengths = lengths;
+    m_matchedPattern = needle;
+    m_matchedCs = m_cs;
+    m_matchedRegex = m_regex;
+
+    if (m_selectOnResult) {
+        m_selectOnResult = false;
+        if (!m_matches.isEmpty()) {
+            auto it = std::lower_bound(m_matches.cbegin(), m_matches.cend(), m_anchor);
+            selectMatch(it == m_matches.cend() ? 0 : static_cast<int>(it - m_matches.cbegin()));
+        }
+    }
+
+    updateHighlights(true);
+    emit matchesChanged();
+}
+
+void IncrementalSearch::onContentsChange(int, int, int) {
+    // Highlighting changes formats only and leaves the snapshot valid
+    if (m_scheduler && m_scheduler->isApplyingFormats()) {
+        return;
+    }
+    if (m_text.isNull() && m_matches.isEmpty()) {
+        return;
+    }
+
+    // Matches refer to the old text; drop them now and search the new text once editing pauses
+    if (m_job) {
+        *m_job = true;
+        m_job.reset();
+    }
+    ++m_generation;
+    m_text = QString();
+    m_folded = QString();
+    m_matches.clear();
+    m_lengths.clear();
+    m_matchedPattern.clear();
+    m_searching = !m_pattern.isEmpty();
+    m_selectOnResult = false;
+    updateHighlights(true);
+
+    if (m_searching) {
+        m_researchTimer.start(ResearchDelayMs);
+    }
+    emit matchesChanged();
+}
+
+int IncrementalSearch::currentMatch() const {
+    QPlainTextEdit* edit = textEdit();
+    if (!edit || m_matches.isEmpty()) {
+        return -1;
+    }
+
+    const QTextCursor cursor = edit->textCursor();
+    auto it = std::lower_bound(m_matches.cbegin(), m_matches.cend(), cursor.selectionStart());
+    if (it == m_matches.cend() || *it != cursor.selectionStart()) {
+        return -1;
+    }
+    const int index = static_cast<int>(it - m_matches.cbegin());
+    return cursor.selectionEnd() - cursor.selectionStart() == matchLength(index) ? index : -1;
+}
+
+bool IncrementalSearch::findDirectly(bool backward) {
+    // A limited search has no direct equivalent; its refreshed matches arrive shortly
+    QPlainTextEdit* edit = textEdit();
+    if (!m_scope.isNull() || !m_error.isEmpty()) {
+        return false;
+    }
+
+    QTextDocument::FindFlags flags;
+    if (backward) {
+        flags |= QTextDocument::FindBackward;
+    }
+    if (m_cs == Qt::CaseSensitive) {
+        flags |= QTextDocument::FindCaseSensitively;
+    }
+    auto find = [&]() { return m_regex ? edit->find(TextSearch::regex(m_pattern, m_cs), flags) : edit->find(m_pattern, flags); };
+
+    const QTextCursor from = edit->textCursor();
+    if (find()) {
+        return true;
+    }
+    edit->moveCursor(backward ? QTextCursor::End : QTextCursor::Start);
+    if (find()) {
+        return true;
+    }
+    edit->setTextCursor(from);
+    return false;
+}
+
+bool IncrementalSearch::findNext() {
+    QPlainTextEdit* edit = textEdit();
+    if (!edit || m_pattern.isEmpty()) {
+        return false;
+    }
+    if (m_searching) {
+        return findDirectly(false);
+    }
+    if (m_matches.isEmpty()) {
+        return false;
+    }
+
+    auto it = std::upper_bound(m_matches.cbegin(), m_matches.cend(), edit->textCursor().selectionStart());
+    selectMatch(it == m_matches.cend() ? 0 : static_cast<int>(it - m_matches.cbegin()));
+    return true;
+}
+
+bool IncrementalSearch::findPrevious() {
+    QPlainTextEdit* edit = textEdit();
+    if (!edit || m_pattern.isEmpty()) {
+        return false;
+    }
+    if (m_searching) {
+        return findDirectly(true);
+    }
+    if (m_matches.isEmpty()) {
+        return false;
+    }
+
+    auto it = std::lower_bound(m_matches.cbegin(), m_matches.cend(), edit->textCursor().selectionStart());
+    const int index = static_cast<int>(it - m_matches.cbegin()) - 1;
+    selectMatch(index < 0 ? static_cast<int>(m_matches.size()) - 1 : index);
+    return true;
+}
+
+void IncrementalSearch::selectMatch(int index) {
+    QPlainTextEdit* edit = textEdit();
+    QTextCursor cursor = edit->textCursor();
+    cursor.setPosition(m_matches[index]);
+    cursor.setPosition(m_matches[index] + matchLength(index), QTextCursor::KeepAnchor);
+    edit->setTextCursor(cursor);
+}
+
+bool IncrementalSearch::replaceCurrent(const QString& replacement) {
+    QPlainTextEdit* edit = textEdit();
+    if (!edit || edit->isReadOnly() || m_pattern.isEmpty() || !m_error.isEmpty()) {
+        return false;
+    }
+
+    // The selection is checked against the pattern itself, so this also works while matches are refreshed
+    QTextCursor cursor = edit->textCursor();
+    const QString selected = TextSearch::withLineBreaks(cursor.selectedText());
+    if (!cursor.hasSelection()) {
+        return false;
+    }
+
+    if (m_regex) {
+        // Matched in the document as the search does, so lookbehind, \b and ^ see the text around the selection
+        takeSnapshot();
+        const QString text = TextSearch::withLineBreaks(m_text);
+        const QRegularExpressionMatch match = TextSearch::regex(m_pattern, m_cs).match(text, cursor.selectionStart(), QRegularExpression::NormalMatch, QRegularExpression::AnchorAtOffsetMatchOption);
+        if (!match.hasMatch() || match.capturedEnd() != cursor.selectionEnd()) {
+            return false;
+        }
+        cursor.insertText(TextSearch::expandReplacement(replacement, match));
+    }
+    else {
+        if (selected.compare(m_pattern, m_cs) != 0) {
+            return false;
+        }
+        cursor.insertText(replacement);
+    }
+    return true;
+}
+
+void IncrementalSearch::replaceAll(const QString& replacement) {
+    QPlainTextEdit* edit = textEdit();
+    if (!edit || edit->isReadOnly() || m_pattern.isEmpty() || !m_error.isEmpty() || m_replaceJob) {
+        return;
+    }
+
+    takeSnapshot();
+
+    auto cancelled = std::make_shared<std::atomic<bool>>(false);
+    m_replaceJob = cancelled;
+
+    std::shared_ptr<State> state = m_state;
+    const quint64 generation = m_generation;
+    const QString text = m_text;
+    const QString folded = m_folded;
+    const QString pattern = m_pattern;
+    const Qt::CaseSensitivity cs = m_cs;
+    const bool regex = m_regex;
+    const QRegularExpression re = regex ? TextSearch::regex(m_pattern, m_cs) : QRegularExpression();
+    int scopeStart = 0;
+    int scopeEnd = 0;
+    scopeRange(&scopeStart, &scopeEnd);
+
+    QThreadPool::globalInstance()->start([state, cancelled, generation, text, folded, pattern, cs, regex, re, replacement, scopeStart, scopeEnd]() {
+        TRACE_SCOPE("IncrementalSearch replaceAll");
+        TextSearch::Replacement result;
+        if (regex) {
+            result = TextSearch::replaceAll(TextSearch::withLineBreaks(text), re, scopeStart, scopeEnd, replacement, cancelled.get());
+        }
+        else {
+            const QString haystack = cs == Qt::CaseSensitive ? text : (folded.isNull() ? TextSearch::fold(text) : folded);
+            const QString needle = cs == Qt::CaseSensitive ? pattern : TextSearch::fold(pattern);
+            result = TextSearch::replaceAll(QStringView(text).sliced(scopeStart, scopeEnd - scopeStart), QStringView(haystack).sliced(scopeStart, scopeEnd - scopeStart), needle,
+                                            replacement);
+            if (result.count > 0) {
+                result.start += scopeStart;
+                result.end += scopeStart;
+            }
+        }
+        if (*cancelled) {
+            return;
+        }
+
+        std::weak_ptr<State> weak = state;
+        QMetaObject::invokeMethod(
+            QCoreApplication::instance(),
+            [weak, generation, result]() {
+                std::shared_ptr<State> s = weak.lock();
+                if (!s || !s->owner) {
+                    return;
+                }
+                IncrementalSearch* search = s->owner;
+                search->m_replaceJob.reset();
+
+                // Offsets are only valid for the snapshot; an edit or a new search since then drops the result
+                QPlainTextEdit* edit = search->textEdit();
+                if (!edit || edit->isReadOnly() || generation != search->m_generation) {
+                    emit search->replaceFinished(-1);
+                    return;
+                }
+                if (result.count > 0) {
+                    QTextCursor cursor(edit->document());
+                    cursor.setPosition(static_cast<int>(result.start));
+                    cursor.setPosition(static_cast<int>(result.end), QTextCursor::KeepAnchor);
+                    cursor.beginEditBlock();
+                    cursor.insertText(result.text);
+                    cursor.endEditBlock();
+                }
+                emit search->replaceFinished(result.count);
+            },
+            Qt::QueuedConnection);
+    });
+}
+
+void IncrementalSearch::updateHighlights(bool force) {
+    QPlainTextEdit* edit = textEdit();
+    if (!edit) {
+        return;
+    }
+
+    if (m_matches.isEmpty()) {
+        if (m_hasHighlights) {
+            m_hasHighlights = false;
+            edit->setExtraSelections({});
+        }
+        m_highlightFirst = m_highlightLast = -1;
+        return;
+    }
+
+    // Only the matches in view get a selection; setting them requests another update, which ends here
+    const int first = edit->cursorForPosition(QPoint(0, 0)).position();
+    const int last = edit->cursorForPosition(QPoint(edit->viewport()->width(), edit->viewport()->height())).position();
+    if (!force && first == m_highlightFirst && last == m_highlightLast) {
+        return;
+    }
+    m_highlightFirst = first;
+    m_highlightLast = last;
+
+    QTextCharFormat format;
+    format.setBackground(QColor(0x62, 0x33, 0x15));
+
+    // Regex matches vary in length, so the search starts a little before the viewport for them too
+    const int reach = m_lengths.isEmpty() ? static_cast<int>(m_pattern.size()) : 1024;
+    QList<QTextEdit::ExtraSelection> selections;
+    QTextCursor cursor(edit->document());
+    for (auto it = std::lower_bound(m_matches.cbegin(), m_matches.cend(), first - reach + 1);
+         it != m_matches.cend() && *it <= last && selections.size() < MaxHighlights; ++it) {
+        const int index = static_cast<int>(it - m_matches.cbegin());
+        if (*it + matchLength(index) < first) {
+            continue;
+        }
+        cursor.setPosition(*it);
+        cursor.setPosition(*it + matchLength(index), QTextCursor::KeepAnchor);
+        selections.append({cursor, format});
+    }
+    edit->setExtraSelections(selections);
+    m_hasHighlights = !selections.isEmpty();
+}
@@ -0,0 +1,122 @@
+#ifndef INCREMENTALSEARCH_H
+#define INCREMENTALSEARCH_H
+
+#include <QObject>
+#include <QPointer>
+#include <QString>
+#include <QTextCursor>
+#include <QTimer>
+#include <QVector>
+#include <atomic>
+#include <memory>
+
+class EditorWidget;
+class HighlightScheduler;
+class QPlainTextEdit;
+
+/**
+ * @brief The IncrementalSearch class
+ *        Find-as-you-type for one editor at a time. Matches are searched on a worker
+ *        thread in a snapshot of the document that is only retaken after an edit, and
+ *        a pattern that grows by a character only re-checks the previous matches.
+ *        Matches inside the viewport are shown as extra selections. Patterns may be
+ *        literal or regular expressions, and the search may be limited to a selection.
+ */
+class IncrementalSearch : public QObject {
+    Q_OBJECT
+
+   public:
+    explicit IncrementalSearch(QObject* parent = nullptr);
+    ~IncrementalSearch() override;  // Drops the result of a search that is still running
+
+    void setEditor(EditorWidget* editor);  // Moves the search, and its highlights, to another editor
+
+    /**
+     * @brief Searches for pattern and selects the first match at or after the start of the
+     *        current selection once the result arrives. An empty pattern clears the search.
+     * @param regex Treats pattern as a regular expression; ^ and $ match at line boundaries.
+     */
+    void setPattern(const QString& pattern, Qt::CaseSensitivity cs, bool regex = false);
+    QString pattern() const { return m_pattern; }
+    Qt::CaseSensitivity caseSensitivity() const { return m_cs; }
+    bool isRegex() const { return m_regex; }
+    QString errorString() const { return m_error; }  // Why the regular expression is invalid, if it is
+
+    // Limits the search to the selection of the given cursor, which follows later edits; a cursor without selection lifts the limit
+    void setScope(const QTextCursor& selection);
+
+    void clear();  // Forgets the pattern and removes the highlights
+
+    int matchCount() const { return static_cast<int>(m_matches.size()); }
+    bool isCapped() const { return m_matches.size() >= MaxMatches; }  // Matches past MaxMatches were not counted
+    bool isSearching() const { return m_searching; }
+    int currentMatch() const;  // Index of the match that is selected in the editor, or -1
+
+    bool findNext();      // Selects the next match after the selection, wrapping around
+    bool findPrevious();  // Selects the match before the selection, wrapping around
+
+    // Replaces the selection if it is a match, expanding capture group references in regex mode
+    bool replaceCurrent(const QString& replacement);
+
+    /**
+     * @brief Replaces every match on a worker thread and applies the result as one edit block.
+     *        replaceFinished() reports the count; the result is dropped if the document was
+     *        edited or the search changed in the meantime.
+     */
+    void replaceAll(const QString& replacement);
+    bool isReplacing() const { return m_replaceJob != nullptr; }
+
+    static constexpr int MaxMatches = 1000000;   // Matches kept per search
+    static constexpr int MaxHighlights = 2000;   // Extra selections shown at most
+    static constexpr int ResearchDelayMs = 150;  // Quiet time after an edit before the matches are refreshed
+
+   signals:
+    void matchesChanged();            // The match count, the current match or the searching state changed
+    void replaceFinished(int count);  // Replace All is done; -1 if it was dropped because the text changed
+
+   private:
+    struct State;  // Shared with the worker so it outlives a search deleted mid-job
+
+    QPlainTextEdit* textEdit() const;
+    void takeSnapshot();  // Retakes m_text if an edit dropped it
+    void scopeRange(int* start, int* end) const;
+    int matchLength(int index) const { return m_lengths.isEmpty() ? static_cast<int>(m_pattern.size()) : m_lengths[index]; }
+    bool findDirectly(bool backward);  // Used while the matches are being refreshed after an edit
+    void startSearch();
+    void onResult(quint64 generation, const QString& needle, const QVector<int>& matches, const QVector<int>& lengths, const QString& folded);
+    void onContentsChange(int from, int charsRemoved, int charsAdded);
+    void updateHighlights(bool force = false);
+    void selectMatch(int index);
+
+    QPointer<EditorWidget> m_editor;
+    QPointer<HighlightScheduler> m_scheduler;  // Tells format-only document changes from edits
+    std::shared_ptr<State> m_state;
+    std::shared_ptr<std::atomic<bool>> m_job;         // Cancellation flag of the running search
+    std::shared_ptr<std::atomic<bool>> m_replaceJob;  // Cancellation flag of the running Replace All
+
+    QString m_pattern;
+    Qt::CaseSensitivity m_cs = Qt::CaseInsensitive;
+    bool m_regex = false;
+    QString m_error;
+    QTextCursor m_scope;  // Selection the search is limited to, if any
+    quint64 m_generation = 0;  // Bumped by every search started; results of older ones are dropped
+    bool m_searching = false;
+    bool m_selectOnResult = false;
+    int m_anchor = 0;  // Position the search-as-you-type result is selected from
+
+    QString m_text;    // Raw text snapshot of the document, null after an edit
+    QString m_folded;  // Case-folded m_text, built on the worker when first needed
+
+    QVector<int> m_matches;     // Match offsets in m_text, ascending
+    QVector<int> m_lengths;     // Length of each match in regex mode; empty when every match is as long as the pattern
+    QString m_matchedPattern;   // Pattern m_matches belong to, case folded unless case sensitive; empty if stale
+    Qt::CaseSensitivity m_matchedCs = Qt::CaseInsensitive;
+    bool m_matchedRegex = false;
+    QTimer m_researchTimer;
+
+    int m_highlightFirst = -1;  // Document range the current highlights were built for
+    int m_highlightLast = -1;
+    bool m_hasHighlights = false;
+};
+
+#endif  // INCREMENTALSEARCH_H
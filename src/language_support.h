@@ -5,9 +5,42 @@
 #include <QString>
 #include <QStringList>
 #include <QSyntaxHighlighter>
+#include <QTextCharFormat>
 #include <QTextDocument>
+#include <QVector>
 #include <functional>
 
+/**
+ * TokenKind / HighlightSpan
+ * -------------------------
+ * The token classes a language lexer can report, and one classified
+ * range of a line. Highlighters map each kind to a QTextCharFormat.
+ */
+enum class TokenKind : quint8 { Keyword, Type, Preprocessor, Comment, Todo, String, Number, Operator, Count };
+
+struct HighlightSpan {
+    int start;
+    int length;
+    TokenKind kind;
+};
+
+/**
+ * HighlightRules
+ * --------------
+ * The immutable part of a language's highlighting: its lexer and the
+ * format shown for every token kind. Each language builds one instance
+ * on first use; every highlighter of that language only refers to it.
+ */
+struct HighlightRules {
+    // Splits a line into spans and returns its end state; must be safe to call from any thread
+    using Tokenizer = int (*)(QStringView text, int previousState, QVector<HighlightSpan>& spans);
+
+    Tokenizer tokenize = nullptr;
+    QTextCharFormat formats[static_cast<int>(TokenKind::Count)];
+
+    const QTextCharFormat& format(TokenKind kind) const { return formats[static_cast<int>(kind)]; }
+};
+
 /**
  * LanguageDefinition
  * ------------------
@@ -1,6 +1,8 @@
-#include "language_support.h"
+#include "languages.h"
 #include "syntax-c.h"
 // #include "syntax-python.h" // etc. if you have more
+#include <QMimeDatabase>
+#include <QStringList>
 
 static const LanguageDefinition SUPPORTED_LANGUAGES[] = {
     {"C/C++", {"text/x-csrc", "text/x-c++src", "text/x-chdr"}, {".c", ".cpp", ".cxx", ".h", ".hpp"}, createCxxHighlighter},
@@ -14,21 +16,62 @@ static const LanguageDefinition SUPPORTED_LANGUAGES[] = {
     // etc...
 };
 
-const LanguageDefinition* findMatchingLanguage(const QMimeType& mime, const QString& lowerFilePath) {
+LanguageRegistry::LanguageRegistry() {
     for (const auto& lang : SUPPORTED_LANGUAGES) {
-        for (const QString& mt : lang.mimeTypes) {
-            if (mime.inherits(mt)) {
-                return &lang;
-            }
+        for (const QString& ext : lang.extensions) {
+            m_byExtension.insert(ext.toLower(), &lang);
         }
     }
+}
 
-    for (const auto& lang : SUPPORTED_LANGUAGES) {
-        for (const QString& ext : lang.extensions) {
-            if (lowerFilePath.endsWith(ext)) {
-                return &lang;
+void LanguageRegistry::buildMimeIndex() const {
+    // Loading the MIME database costs milliseconds, so it waits until a lookup by MIME type needs it
+    std::call_once(m_mimeIndexOnce, [this]() {
+        QMimeDatabase db;
+        for (const auto& lang : SUPPORTED_LANGUAGES) {
+            // Registered under the canonical name, since that is what lookups see after alias resolution
+            for (const QString& mt : lang.mimeTypes) {
+                const QMimeType mime = db.mimeTypeForName(mt);
+                m_byMimeType.insert(mime.isValid() ? mime.name() : mt, &lang);
             }
         }
+    });
+}
+
+const LanguageRegistry& LanguageRegistry::instance() {
+    static const LanguageRegistry registry;
+    return registry;
+}
+
+const LanguageDefinition* LanguageRegistry::forFileName(const QString& fileName) const {
+    const qsizetype slash = fileName.lastIndexOf(QLatin1Char('/'));
+    const qsizetype dot = fileName.lastIndexOf(QLatin1Char('.'));
+    if (dot > slash + 1) {
+        return m_byExtension.value(fileName.mid(dot).toLower());
+    }
+    return nullptr;
+}
+
+const LanguageDefinition* LanguageRegistry::forMimeType(const QMimeType& mime) const {
+    if (!mime.isValid()) {
+        return nullptr;
+    }
+    buildMimeIndex();
+    if (m_byMimeType.isEmpty()) {
+        return nullptr;
+    }
+    if (const LanguageDefinition* lang = m_byMimeType.value(mime.name())) {
+        return lang;
+    }
+    for (const QString& alias : mime.aliases()) {
+        if (const LanguageDefinition* lang = m_byMimeType.value(alias)) {
+            return lang;
+        }
+    }
+    for (const QString& ancestor : mime.allAncestors()) {
+        if (const LanguageDefinition* lang = m_byMimeType.value(ancestor)) {
+            return lang;
+        }
     }
-    return nullptr;  // No match
+    return nullptr;
 }
@@ -0,0 +1,48 @@
+#ifndef LANGUAGES_H
+#define LANGUAGES_H
+
+#include <QHash>
+#include <QMimeType>
+#include <QString>
+#include <mutex>
+
+#include "language_support.h"
+
+/**
+ * @brief The LanguageRegistry class
+ *        Every supported language, indexed by file extension and by MIME type. The
+ *        indexes are built once, so detecting the language of a file costs a hash
+ *        lookup no matter how many languages are registered, and never reads the file.
+ *        The MIME index is only built on the first lookup by MIME type, which keeps
+ *        the MIME database out of startup.
+ */
+class LanguageRegistry {
+   public:
+    static const LanguageRegistry& instance();  // Builds the indexes on first use
+
+    /**
+     * @brief Finds a language from the file extension alone.
+     *        Other spellings (.cc, .hh, ...) are left to the loader's content sniffing,
+     *        which matches the MIME database's glob patterns on a worker thread.
+     * @param fileName A file name or path.
+     * @return The language, or nullptr if the name gives no match.
+     */
+    const LanguageDefinition* forFileName(const QString& fileName) const;
+
+    /**
+     * @brief Finds a language from a MIME type, e.g. one sniffed from a file's first bytes.
+     *        The type's name and aliases are tried first, then its ancestors.
+     * @return The language, or nullptr if no registered MIME type matches.
+     */
+    const LanguageDefinition* forMimeType(const QMimeType& mime) const;
+
+   private:
+    LanguageRegistry();
+    void buildMimeIndex() const;  // Fills m_byMimeType on first use; safe to call from any thread
+
+    QHash<QString, const LanguageDefinition*> m_byExtension;         // Lower-case extension including the dot
+    mutable QHash<QString, const LanguageDefinition*> m_byMimeType;  // Canonical MIME type name
+    mutable std::once_flag m_mimeIndexOnce;                          // Guards the one build of m_byMimeType
+};
+
+#endif  // LANGUAGES_H
@@ -0,0 +1,396 @@
+#include "largefileview.h"
+#include "mappedfile.h"
+#include "piecetable.h"
+#include "trace.h"
+#include <QKeyEvent>
+#include <QMouseEvent>
+#include <QPaintEvent>
+#include <QPainter>
+#include <QSaveFile>
+#include <QScrollBar>
+#include <climits>
+
+LargeFileView::LargeFileView(QWidget* parent) : QAbstractScrollArea(parent) {
+    m_file = new MappedFile(this);
+
+    QPalette pal = viewport()->palette();
+    pal.setColor(QPalette::Base, QColor("#000"));
+    pal.setColor(QPalette::Text, QColor("#FFF"));
+    viewport()->setPalette(pal);
+    viewport()->setAutoFillBackground(true);
+
+    connect(m_file, &MappedFile::indexProgress, this, [this](qint64) {
+        updateScrollBars();
+        viewport()->update();
+        emit visibleLinesChanged();
+    });
+    connect(m_file, &MappedFile::indexFinished, this, [this]() {
+        startEditing();
+        updateScrollBars();
+        viewport()->update();
+    });
+    connect(verticalScrollBar(), &QScrollBar::valueChanged, this, &LargeFileView::visibleLinesChanged);
+}
+
+LargeFileView::~LargeFileView() = default;
+
+bool LargeFileView::openFile(const QString& path) {
+    m_maxLineWidth = 0;
+    m_table.reset();
+    m_cursor = 0;
+    m_goalX = -1;
+    if (!m_file->open(path)) {
+        return false;
+    }
+
+    // An empty file is indexed without a worker, so indexFinished() is never emitted for it
+    if (m_file->isIndexComplete()) {
+        startEditing();
+    }
+
+    verticalScrollBar()->setValue(0);
+    horizontalScrollBar()->setValue(0);
+    updateScrollBars();
+    viewport()->update();
+    return true;
+}
+
+void LargeFileView::startEditing() {
+    m_table = std::make_unique<PieceTable>(m_file);
+    const qint64 firstBreak = m_table->lineCount() > 1 ? m_table->lineStart(1) - 1 : 0;
+    m_lineBreak = firstBreak > 0 && m_table->read(firstBreak - 1, 1) == "\r" ? QByteArrayLiteral("\r\n") : QByteArrayLiteral("\n");
+}
+
+qint64 LargeFileView::firstVisibleLine() const {
+    return verticalScrollBar()->value();
+}
+
+qint64 LargeFileView::lineCount() const {
+    return m_table ? m_table->lineCount() : m_file->lineCount();
+}
+
+qint64 LargeFileView::cursorLine() const {
+    return m_table ? m_table->lineAt(m_cursor) : firstVisibleLine();
+}
+
+QString LargeFileView::lineText(qint64 line) const {
+    return m_table ? m_table->lineText(line) : m_file->lineText(line);
+}
+
+bool LargeFileView::isModified() const {
+    return m_table && m_table->isModified();
+}
+
+bool LargeFileView::save(const QString& path, QString* errorString) {
+    if (m_table) {
+        const bool wasModified = m_table->isModified();
+        if (!m_table->save(path, errorString)) {
+            return false;
+        }
+        if (wasModified) {
+            emit modificationChanged(false);
+        }
+        return true;
+    }
+
+    // Still indexing, so nothing can have been edited yet
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly) || file.write(m_file->data(), m_file->size()) != m_file->size() || !file.commit()) {
+        if (errorString)
+            *errorString = file.errorString();
+        return false;
+    }
+    return true;
+}
+
+int LargeFileView::gutterWidth() const {
+    int digits = 1;
+    qint64 maxLines = qMax<qint64>(1, lineCount());
+    while (maxLines >= 10) {
+        maxLines /= 10;
+        ++digits;
+    }
+    return 3 + fontMetrics().horizontalAdvance(QLatin1Char('9')) * digits + 4;
+}
+
+int LargeFileView::visibleLineCount() const {
+    return qMax(1, viewport()->height() / fontMetrics().height());
+}
+
+void LargeFileView::updateScrollBars() {
+    qint64 maxFirstLine = qMax<qint64>(0, lineCount() - visibleLineCount());
+    verticalScrollBar()->setRange(0, static_cast<int>(qMin<qint64>(maxFirstLine, INT_MAX)));
+    verticalScrollBar()->setPageStep(visibleLineCount());
+    verticalScrollBar()->setSingleStep(1);
+
+    int textWidth = viewport()->width() - gutterWidth();
+    horizontalScrollBar()->setRange(0, qMax(0, m_maxLineWidth - textWidth));
+    horizontalScrollBar()->setPageStep(qMax(1, textWidth));
+    horizontalScrollBar()->setSingleStep(fontMetrics().horizontalAdvance(QLatin1Char('9')));
+}
+
+void LargeFileView::paintEvent(QPaintEvent* event) {
+    QPainter painter(viewport());
+    const QRect area = event->rect();
+    const int lineHeight = fontMetrics().height();
+    const int ascent = fontMetrics().ascent();
+    const int gutter = gutterWidth();
+    const int xOffset = horizontalScrollBar()->value();
+
+    painter.fillRect(QRect(0, area.top(), gutter, area.height()), Qt::lightGray);
+
+    qint64 line = firstVisibleLine();
+    const qint64 lastLine = qMin(line + visibleLineCount() + 1, lineCount());
+    int widest = m_maxLineWidth;
+
+    painter.setClipRect(QRect(gutter, area.top(), viewport()->width() - gutter, area.height()));
+    painter.setPen(viewport()->palette().color(QPalette::Text));
+    for (int y = 0; line < lastLine; ++line, y += lineHeight) {
+        if (y + lineHeight < area.top() || y > area.bottom()) {
+            continue;
+        }
+        const QString text = lineText(line);
+        painter.drawText(gutter + 2 - xOffset, y + ascent, text);
+        widest = qMax(widest, fontMetrics().horizontalAdvance(text) + 4);
+    }
+
+    if (m_table && hasFocus()) {
+        const qint64 cursorRow = m_table->lineAt(m_cursor) - firstVisibleLine();
+        if (cursorRow >= 0 && cursorRow <= visibleLineCount()) {
+            const int x = gutter + 2 - xOffset + xOfOffset(m_cursor);
+            const int y = static_cast<int>(cursorRow) * lineHeight;
+            painter.fillRect(QRect(x, y, 1, lineHeight), viewport()->palette().color(QPalette::Text));
+        }
+    }
+
+    painter.setClipping(false);
+    painter.setPen(QColor("#00008B"));
+    line = firstVisibleLine();
+    for (int y = 0; line < lastLine; ++line, y += lineHeight) {
+        painter.drawText(0, y, gutter - 4, lineHeight, Qt::AlignRight, QString::number(line + 1));
+    }
+
+    if (widest != m_maxLineWidth) {
+        m_maxLineWidth = widest;
+        updateScrollBars();
+    }
+}
+
+void LargeFileView::resizeEvent(QResizeEvent* event) {
+    QAbstractScrollArea::resizeEvent(event);
+    updateScrollBars();
+}
+
+void LargeFileView::keyPressEvent(QKeyEvent* event) {
+    if (m_table && editKey(event)) {
+        return;
+    }
+    if (event->key() == Qt::Key_Home && event->modifiers() & Qt::ControlModifier) {
+        verticalScrollBar()->triggerAction(QAbstractSlider::SliderToMinimum);
+    }
+    else if (event->key() == Qt::Key_End && event->modifiers() & Qt::ControlModifier) {
+        verticalScrollBar()->triggerAction(QAbstractSlider::SliderToMaximum);
+    }
+    else if (event->key() == Qt::Key_Home) {
+        horizontalScrollBar()->triggerAction(QAbstractSlider::SliderToMinimum);
+    }
+    else if (event->key() == Qt::Key_End) {
+        horizontalScrollBar()->triggerAction(QAbstractSlider::SliderToMaximum);
+    }
+    else {
+        QAbstractScrollArea::keyPressEvent(event);
+    }
+}
+
+void LargeFileView::mousePressEvent(QMouseEvent* event) {
+    if (!m_table || event->button() != Qt::LeftButton) {
+        QAbstractScrollArea::mousePressEvent(event);
+        return;
+    }
+    const QPoint pos = event->position().toPoint();
+    const qint64 line = qMin(firstVisibleLine() + pos.y() / fontMetrics().height(), lineCount() - 1);
+    setCursorOffset(offsetAtX(line, pos.x() - gutterWidth() - 2 + horizontalScrollBar()->value()));
+}
+
+bool LargeFileView::focusNextPrevChild(bool next) {
+    return m_table ? false : QAbstractScrollArea::focusNextPrevChild(next);
+}
+
+bool LargeFileView::editKey(QKeyEvent* event) {
+    TRACE_SCOPE("LargeFileView::editKey");
+    const bool wasModified = m_table->isModified();
+    const qint64 line = m_table->lineAt(m_cursor);
+
+    if (event->matches(QKeySequence::Undo)) {
+        if (m_table->canUndo()) {
+            const qint64 offset = m_table->undo();
+            edited(wasModified);
+            setCursorOffset(offset);
+        }
+        return true;
+    }
+    if (event->matches(QKeySequence::Redo)) {
+        if (m_table->canRedo()) {
+            const qint64 offset = m_table->redo();
+            edited(wasModified);
+            setCursorOffset(offset);
+        }
+        return true;
+    }
+    if (event->matches(QKeySequence::MoveToStartOfDocument)) {
+        setCursorOffset(0);
+        return true;
+    }
+    if (event->matches(QKeySequence::MoveToEndOfDocument)) {
+        setCursorOffset(m_table->size());
+        return true;
+    }
+
+    const int goalX = m_goalX >= 0 ? m_goalX : xOfOffset(m_cursor);
+    switch (event->key()) {
+        case Qt::Key_Left:
+            setCursorOffset(previousCharacter(m_cursor));
+            return true;
+        case Qt::Key_Right:
+            setCursorOffset(nextCharacter(m_cursor));
+            return true;
+        case Qt::Key_Up:
+        case Qt::Key_Down:
+        case Qt::Key_PageUp:
+        case Qt::Key_PageDown: {
+            const qint64 step = (event->key() == Qt::Key_PageUp || event->key() == Qt::Key_PageDown) ? visibleLineCount() : 1;
+            const qint64 target = (event->key() == Qt::Key_Up || event->key() == Qt::Key_PageUp) ? line - step : line + step;
+            m_goalX = goalX;
+            setCursorOffset(offsetAtX(qBound<qint64>(0, target, lineCount() - 1), goalX), true);
+            return true;
+        }
+        case Qt::Key_Home:
+            setCursorOffset(m_table->lineStart(line));
+            return true;
+        case Qt::Key_End:
+            setCursorOffset(m_table->lineEnd(line));
+            return true;
+        case Qt::Key_Backspace: {
+            const qint64 from = previousCharacter(m_cursor);
+            m_table->remove(from, m_cursor - from);
+            edited(wasModified);
+            setCursorOffset(from);
+            return true;
+        }
+        case Qt::Key_Delete:
+            m_table->remove(m_cursor, nextCharacter(m_cursor) - m_cursor);
+            edited(wasModified);
+            return true;
+        case Qt::Key_Return:
+        case Qt::Key_Enter:
+            m_table->insert(m_cursor, m_lineBreak);
+            edited(wasModified);
+            setCursorOffset(m_cursor + m_lineBreak.size());
+            return true;
+        default:
+            break;
+    }
+
+    const QString text = event->text();
+    if (text.isEmpty() || (!text.at(0).isPrint() && text.at(0) != QLatin1Char('\t'))) {
+        return false;
+    }
+    const QByteArray bytes = text.toUtf8();
+    m_table->insert(m_cursor, bytes);
+    edited(wasModified);
+    setCursorOffset(m_cursor + bytes.size());
+    return true;
+}
+
+void LargeFileView::edited(bool wasModified) {
+    updateScrollBars();
+    viewport()->update();
+    if (m_table->isModified() != wasModified) {
+        emit modificationChanged(!wasModified);
+    }
+}
+
+void LargeFileView::setCursorOffset(qint64 offset, bool keepGoal) {
+    m_cursor = qBound<qint64>(0, offset, m_table->size());
+    if (!keepGoal) {
+        m_goalX = -1;
+    }
+    ensureCursorVisible();
+    viewport()->update();
+    emit visibleLinesChanged();
+}
+
+void LargeFileView::ensureCursorVisible() {
+    const qint64 line = m_table->lineAt(m_cursor);
+    QScrollBar* bar = verticalScrollBar();
+    if (line < bar->value()) {
+        bar->setValue(static_cast<int>(line));
+    }
+    else if (line >= bar->value() + visibleLineCount()) {
+        bar->setValue(static_cast<int>(line - visibleLineCount() + 1));
+    }
+
+    const int x = xOfOffset(m_cursor);
+    const int textWidth = viewport()->width() - gutterWidth() - 4;
+    QScrollBar* hbar = horizontalScrollBar();
+    if (x < hbar->value()) {
+        hbar->setValue(x);
+    }
+    else if (x > hbar->value() + textWidth) {
+        m_maxLineWidth = qMax(m_maxLineWidth, x + 4);
+        updateScrollBars();
+        hbar->setValue(x - textWidth);
+    }
+}
+
+int LargeFileView::xOfOffset(qint64 offset) const {
+    // Past MaxLineBytes nothing is painted, so the prefix decoded on every key and paint is capped there
+    const qint64 start = m_table->lineStart(m_table->lineAt(offset));
+    return fontMetrics().horizontalAdvance(QString::fromUtf8(m_table->read(start, qMin(offset - start, MaxLineBytes))));
+}
+
+qint64 LargeFileView::offsetAtX(qint64 line, int x) const {
+    // Walks the bytes of the line a character at a time until the next one would end past x; an invalid
+    // byte is one character, so the offset found is always one the raw text has
+    const qint64 start = m_table->lineStart(line);
+    const qint64 end = qMin(m_table->lineEnd(line), start + MaxLineBytes);
+    const QFontMetrics metrics = fontMetrics();
+    qint64 offset = start;
+    int left = 0;
+    while (offset < end) {
+        const qint64 next = nextCharacter(offset);
+        const int width = metrics.horizontalAdvance(QString::fromUtf8(m_table->read(offset, next - offset)));
+        if (left + width / 2 > x) {
+            break;
+        }
+        left += width;
+        offset = next;
+    }
+    return offset;
+}
+
+qint64 LargeFileView::nextCharacter(qint64 offset) const {
+    if (m_table->read(offset, 2) == "\r\n") {
+        return offset + 2;
+    }
+    qint64 next = qMin(offset + 1, m_table->size());
+    const QByteArray tail = m_table->read(next, 3);
+    for (char byte : tail) {
+        if ((static_cast<uchar>(byte) & 0xC0) != 0x80) {
+            break;
+        }
+        ++next;
+    }
+    return next;
+}
+
+qint64 LargeFileView::previousCharacter(qint64 offset) const {
+    if (offset >= 2 && m_table->read(offset - 2, 2) == "\r\n") {
+        return offset - 2;
+    }
+    qint64 previous = qMax<qint64>(0, offset - 1);
+    while (previous > 0 && previous > offset - 4 && (static_cast<uchar>(m_table->read(previous, 1).at(0)) & 0xC0) == 0x80) {
+        --previous;
+    }
+    return previous;
+}
@@ -0,0 +1,81 @@
+#ifndef LARGEFILEVIEW_H
+#define LARGEFILEVIEW_H
+
+#include <QAbstractScrollArea>
+#include <QString>
+#include <memory>
+
+class MappedFile;
+class PieceTable;
+
+/**
+ * @brief The LargeFileView class
+ *        Editor for files too big for QPlainTextEdit. Text stays in the memory
+ *        mapping, edits go to a PieceTable on top of it, and only the lines inside
+ *        the viewport are decoded and painted. The file can be read as soon as it is
+ *        mapped and edited once its line index is complete.
+ */
+class LargeFileView : public QAbstractScrollArea {
+    Q_OBJECT
+
+   public:
+    explicit LargeFileView(QWidget* parent = nullptr);
+    ~LargeFileView() override;
+
+    /**
+     * @brief Maps the file and shows its first screen; indexing continues in the background.
+     * @param path The file to display.
+     * @return false if the file cannot be mapped.
+     */
+    bool openFile(const QString& path);
+
+    MappedFile* mappedFile() const { return m_file; }
+    PieceTable* pieceTable() const { return m_table.get(); }  // Null until the line index is complete
+
+    qint64 firstVisibleLine() const;  // Zero-based number of the top line in the viewport
+    qint64 lineCount() const;         // Lines of the edited text, or those indexed so far
+    qint64 cursorLine() const;        // Zero-based line of the text cursor
+
+    bool isModified() const;
+
+    // Writes the text, with any edits, to path without reading it all into memory
+    bool save(const QString& path, QString* errorString = nullptr);
+
+   signals:
+    void visibleLinesChanged();           // Emitted when scrolling, indexing or the cursor changes what the viewport shows
+    void modificationChanged(bool modified);
+
+   protected:
+    void paintEvent(QPaintEvent* event) override;
+    void resizeEvent(QResizeEvent* event) override;
+    void keyPressEvent(QKeyEvent* event) override;
+    void mousePressEvent(QMouseEvent* event) override;
+    bool focusNextPrevChild(bool next) override;  // Keeps Tab for typing once the text is editable
+
+   private:
+    static constexpr qint64 MaxLineBytes = 64 * 1024;  // Bytes of a line measured for the cursor, as many as lineText() decodes
+
+    int gutterWidth() const;  // Width of the line number column for the current line count
+    int visibleLineCount() const;
+    void updateScrollBars();
+    QString lineText(qint64 line) const;
+    void startEditing();  // Puts a PieceTable over the indexed file
+
+    bool editKey(QKeyEvent* event);  // Handles a key of the editable view; false if it is not an editing key
+    void edited(bool wasModified);   // Refreshes the view after an edit, undo or redo
+    void setCursorOffset(qint64 offset, bool keepGoal = false);
+    void ensureCursorVisible();
+    int xOfOffset(qint64 offset) const;              // Horizontal position of offset within its line
+    qint64 offsetAtX(qint64 line, int x) const;      // Offset of the character boundary in line nearest to x
+    qint64 nextCharacter(qint64 offset) const;       // Offset after the UTF-8 sequence or "\r\n" at offset
+    qint64 previousCharacter(qint64 offset) const;   // Offset of the UTF-8 sequence or "\r\n" before offset
+
+    MappedFile* m_file = nullptr;         // Mapping and line index of the displayed file
+    std::unique_ptr<PieceTable> m_table;  // The text with its edits, once the file is indexed
+    qint64 m_cursor = 0;                  // Byte offset of the text cursor
+    QByteArray m_lineBreak;               // What Enter inserts: "\r\n" if the file's first line ends so, else "\n"
+    int m_goalX = -1;                     // Horizontal position moving up and down keeps to, or -1
+    int m_maxLineWidth = 0;               // Widest line painted so far, drives the horizontal scroll range
+};
+
+#endif  // LARGEFILEVIEW_H
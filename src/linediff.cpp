@@ -0,0 +1,129 @@
+#include "linediff.h"
+#include "trace.h"
+#include <QHash>
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+using Hunk = LineDiff::Hunk;
+
+// Appends a one-line insertion or deletion at old line x and new line y, merging it into the last hunk if adjacent
+void addEdit(QVector<Hunk>& hunks, int x, int y, bool insertion) {
+    if (!hunks.isEmpty()) {
+        Hunk& last = hunks.last();
+        if (last.oldStart + last.oldCount == x && last.newStart + last.newCount == y) {
+            ++(insertion ? last.newCount : last.oldCount);
+            return;
+        }
+    }
+    hunks.append({x, insertion ? 0 : 1, y, insertion ? 1 : 0});
+}
+
+// Myers' greedy forward search over line ids; false if the edit distance exceeds MaxEditDistance
+bool myers(const std::vector<int>& a, const std::vector<int>& b, QVector<Hunk>* hunks) {
+    const int n = static_cast<int>(a.size());
+    const int m = static_cast<int>(b.size());
+    const int max = std::min(n + m, LineDiff::MaxEditDistance);
+
+    // v[k + offset] is the furthest x reached on diagonal k = x - y
+    const int offset = max + 1;
+    std::vector<int> v(2 * max + 3, 0);
+
+    // The diagonals -d - 1 to d + 1 of v as each round d starts, for walking the path back
+    std::vector<std::vector<int>> trace;
+
+    for (int d = 0; d <= max; ++d) {
+        trace.emplace_back(v.begin() + offset - d - 1, v.begin() + offset + d + 2);
+
+        for (int k = -d; k <= d; k += 2) {
+            int x = (k == -d || (k != d && v[offset + k - 1] < v[offset + k + 1])) ? v[offset + k + 1] : v[offset + k - 1] + 1;
+            int y = x - k;
+            while (x < n && y < m && a[x] == b[y]) {
+                ++x;
+                ++y;
+            }
+            v[offset + k] = x;
+            if (x < n || y < m) {
+                continue;
+            }
+
+            // Walks from the end back to the start, collecting one edit per round
+            QVector<Hunk> reversed;
+            for (int step = d; step > 0; --step) {
+                const std::vector<int>& prev = trace[step];
+                auto at = [&](int diagonal) { return prev[diagonal + step + 1]; };
+                const int diagonal = x - y;
+                const int prevK = (diagonal == -step || (diagonal != step && at(diagonal - 1) < at(diagonal + 1))) ? diagonal + 1 : diagonal - 1;
+                const int prevX = at(prevK);
+                const int prevY = prevX - prevK;
+                while (x > prevX && y > prevY) {
+                    --x;
+                    --y;
+                }
+                const bool insertion = x == prevX;
+                reversed.append({prevX, insertion ? 0 : 1, prevY, insertion ? 1 : 0});
+                x = prevX;
+                y = prevY;
+            }
+            for (auto it = reversed.crbegin(); it != reversed.crend(); ++it) {
+                addEdit(*hunks, it->oldStart, it->newStart, it->newCount == 1);
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+}  // namespace
+
+QVector<LineDiff::Hunk> LineDiff::diff(const QStringList& oldLines, const QStringList& newLines) {
+    TRACE_SCOPE("LineDiff::diff");
+    const int n = static_cast<int>(oldLines.size());
+    const int m = static_cast<int>(newLines.size());
+
+    int prefix = 0;
+    while (prefix < n && prefix < m && oldLines[prefix] == newLines[prefix]) {
+        ++prefix;
+    }
+    int suffix = 0;
+    while (suffix < n - prefix && suffix < m - prefix && oldLines[n - 1 - suffix] == newLines[m - 1 - suffix]) {
+        ++suffix;
+    }
+    const int oldCount = n - prefix - suffix;
+    const int newCount = m - prefix - suffix;
+    if (oldCount == 0 && newCount == 0) {
+        return {};
+    }
+    if (oldCount == 0 || newCount == 0) {
+        return {{prefix, oldCount, prefix, newCount}};
+    }
+
+    // Lines are compared as small integers, so each string is hashed once instead of compared again and again
+    QHash<QString, int> ids;
+    auto idOf = [&ids](const QString& line) {
+        auto it = ids.constFind(line);
+        if (it == ids.constEnd()) {
+            it = ids.insert(line, static_cast<int>(ids.size()));
+        }
+        return it.value();
+    };
+    std::vector<int> a(oldCount);
+    std::vector<int> b(newCount);
+    for (int i = 0; i < oldCount; ++i) {
+        a[i] = idOf(oldLines[prefix + i]);
+    }
+    for (int i = 0; i < newCount; ++i) {
+        b[i] = idOf(newLines[prefix + i]);
+    }
+
+    QVector<Hunk> hunks;
+    if (!myers(a, b, &hunks)) {
+        return {{prefix, oldCount, prefix, newCount}};
+    }
+    for (Hunk& hunk : hunks) {
+        hunk.oldStart += prefix;
+        hunk.newStart += prefix;
+    }
+    return hunks;
+}
@@ -0,0 +1,30 @@
+#ifndef LINEDIFF_H
+#define LINEDIFF_H
+
+#include <QStringList>
+#include <QVector>
+
+/**
+ * @brief The LineDiff class
+ *        Line-based diff after Myers' O(ND) algorithm. Common leading and trailing
+ *        lines are trimmed first, so a small change in a large file only runs the
+ *        algorithm on the few lines around it. Differences too large for the edit
+ *        budget come back as one hunk replacing everything between the common ends.
+ */
+class LineDiff {
+   public:
+    // Lines [oldStart, oldStart + oldCount) of the old text become [newStart, newStart + newCount) of the new one
+    struct Hunk {
+        int oldStart = 0;
+        int oldCount = 0;
+        int newStart = 0;
+        int newCount = 0;
+    };
+
+    // The hunks turning oldLines into newLines, in ascending order; empty if both are equal
+    static QVector<Hunk> diff(const QStringList& oldLines, const QStringList& newLines);
+
+    static constexpr int MaxEditDistance = 2000;  // Inserted plus deleted lines Myers' algorithm searches before giving up
+};
+
+#endif  // LINEDIFF_H
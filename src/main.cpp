@@ -0,0 +1,27 @@
+#include "startupprofile.h"
+#include "texxy.h"
+#include "trace.h"
+#include <QApplication>
+
+int main(int argc, char* argv[]) {
+    for (int i = 1; i < argc; ++i) {
+        if (qstrcmp(argv[i], "--startup-profile") == 0) {
+            StartupProfile::start();
+        }
+    }
+
+    QApplication app(argc, argv);
+    StartupProfile::mark("QApplication");
+
+    // TEXXY_TRACE records from the start and writes the trace when texxy quits
+    const QString tracePath = Trace::startFromEnvironment();
+    if (!tracePath.isEmpty()) {
+        QObject::connect(&app, &QCoreApplication::aboutToQuit, [tracePath]() { Trace::writeChromeTrace(tracePath); });
+    }
+
+    Texxy editor;
+    StartupProfile::mark("main window");
+    editor.show();
+    StartupProfile::mark("show");
+    return app.exec();
+}
@@ -0,0 +1,235 @@
+#include "mappedfile.h"
+#include <QCoreApplication>
+#include <QFile>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QThreadPool>
+#include <QtAlgorithms>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+struct MappedFile::Mapping {
+    QFile file;
+    uchar* map = nullptr;
+    qint64 size = 0;
+    std::atomic<bool> cancelled{false};
+
+    QMutex mutex;                 // Guards pending and finished
+    std::vector<qint64> pending;  // Line starts found by the worker but not yet handed to the owner
+    bool finished = false;        // True once the worker has scanned the last chunk
+    MappedFile* owner = nullptr;  // Only touched on the GUI thread
+
+    ~Mapping() {
+        if (map) {
+            file.unmap(map);
+        }
+    }
+};
+
+MappedFile::MappedFile(QObject* parent) : QObject(parent) {}
+
+MappedFile::~MappedFile() {
+    if (m_mapping) {
+        m_mapping->cancelled = true;
+        m_mapping->owner = nullptr;
+    }
+}
+
+bool MappedFile::open(const QString& path) {
+    if (m_mapping) {
+        m_mapping->cancelled = true;
+        m_mapping->owner = nullptr;
+    }
+    m_mapping.reset();
+    m_lineStarts.clear();
+    m_indexComplete = false;
+
+    auto mapping = std::make_shared<Mapping>();
+    mapping->file.setFileName(path);
+    if (!mapping->file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    mapping->size = mapping->file.size();
+    if (mapping->size > 0) {
+        mapping->map = mapping->file.map(0, mapping->size);
+        if (!mapping->map) {
+            return false;
+        }
+    }
+
+    mapping->owner = this;
+    m_mapping = mapping;
+    m_path = path;
+    m_lineStarts.push_back(0);
+
+    if (mapping->size == 0) {
+        m_indexComplete = true;
+        return true;
+    }
+
+    startIndexing();
+    return true;
+}
+
+const char* MappedFile::data() const {
+    return m_mapping ? reinterpret_cast<const char*>(m_mapping->map) : nullptr;
+}
+
+qint64 MappedFile::size() const {
+    return m_mapping ? m_mapping->size : 0;
+}
+
+qint64 MappedFile::lineStart(qint64 line) const {
+    if (line < 0 || line >= lineCount()) {
+        return size();
+    }
+    return m_lineStarts[static_cast<size_t>(line)];
+}
+
+qint64 MappedFile::lineEnd(qint64 line) const {
+    if (line < 0 || line >= lineCount()) {
+        return size();
+    }
+
+    const char* base = data();
+    qint64 start = m_lineStarts[static_cast<size_t>(line)];
+    qint64 end = size();
+    if (line + 1 < lineCount()) {
+        end = m_lineStarts[static_cast<size_t>(line + 1)] - 1;
+    }
+    else if (!m_indexComplete && start < end) {
+        // The line after this one has not been indexed yet
+        const void* nl = std::memchr(base + start, '\n', static_cast<size_t>(end - start));
+        if (nl) {
+            end = static_cast<const char*>(nl) - base;
+        }
+    }
+
+    if (end > start && base[end - 1] == '\r') {
+        --end;
+    }
+    return end;
+}
+
+qint64 MappedFile::lineAt(qint64 offset) const {
+    const auto it = std::upper_bound(m_lineStarts.cbegin(), m_lineStarts.cend(), offset);
+    return qMax<qint64>(0, (it - m_lineStarts.cbegin()) - 1);
+}
+
+qint64 MappedFile::newlinesBetween(qint64 begin, qint64 end) const {
+    if (end <= begin) {
+        return 0;
+    }
+
+    // A break at offset p starts the line at p + 1
+    qint64 count = (std::upper_bound(m_lineStarts.cbegin(), m_lineStarts.cend(), end) - m_lineStarts.cbegin()) -
+                   (std::upper_bound(m_lineStarts.cbegin(), m_lineStarts.cend(), begin) - m_lineStarts.cbegin());
+
+    // The index drops the empty line after a final line break, but the break itself is there
+    if (begin < size() && end >= size() && data()[size() - 1] == '\n') {
+        ++count;
+    }
+    return count;
+}
+
+QString MappedFile::lineText(qint64 line, qint64 maxBytes) const {
+    if (line < 0 || line >= lineCount()) {
+        return QString();
+    }
+
+    qint64 start = lineStart(line);
+    qint64 length = qMin(lineEnd(line) - start, maxBytes);
+    if (length <= 0) {
+        return QString();
+    }
+    return QString::fromUtf8(data() + start, length);
+}
+
+void MappedFile::scanNewlines(const char* data, qint64 begin, qint64 end, std::vector<qint64>& out) {
+    qint64 i = begin;
+
+#if defined(__SSE2__)
+    const __m128i newline = _mm_set1_epi8('\n');
+    for (; i + 16 <= end; i += 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        quint32 mask = static_cast<quint32>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, newline)));
+        while (mask) {
+            out.push_back(i + qCountTrailingZeroBits(mask) + 1);
+            mask &= mask - 1;
+        }
+    }
+#endif
+
+    for (; i < end; ++i) {
+        if (data[i] == '\n') {
+            out.push_back(i + 1);
+        }
+    }
+}
+
+void MappedFile::startIndexing() {
+    std::shared_ptr<Mapping> mapping = m_mapping;
+
+    QThreadPool::globalInstance()->start([mapping]() {
+        constexpr qint64 ChunkSize = 8 * 1024 * 1024;
+        const char* base = reinterpret_cast<const char*>(mapping->map);
+        std::vector<qint64> found;
+
+        for (qint64 begin = 0; begin < mapping->size; begin += ChunkSize) {
+            if (mapping->cancelled) {
+                return;
+            }
+
+            found.clear();
+            qint64 end = qMin(begin + ChunkSize, mapping->size);
+            scanNewlines(base, begin, end, found);
+
+            {
+                QMutexLocker locker(&mapping->mutex);
+                mapping->pending.insert(mapping->pending.end(), found.begin(), found.end());
+                mapping->finished = (end == mapping->size);
+            }
+
+            std::weak_ptr<Mapping> weak = mapping;
+            QMetaObject::invokeMethod(
+                QCoreApplication::instance(),
+                [weak]() {
+                    std::shared_ptr<Mapping> m = weak.lock();
+                    if (m && m->owner) {
+                        m->owner->drainIndexedLines();
+                    }
+                },
+                Qt::QueuedConnection);
+        }
+    });
+}
+
+void MappedFile::drainIndexedLines() {
+    bool finished = false;
+    size_t before = m_lineStarts.size();
+    {
+        QMutexLocker locker(&m_mapping->mutex);
+        m_lineStarts.insert(m_lineStarts.end(), m_mapping->pending.begin(), m_mapping->pending.end());
+        m_mapping->pending.clear();
+        finished = m_mapping->finished;
+    }
+
+    // A file ending in a line break has no further line after it
+    if (finished && m_lineStarts.size() > 1 && m_lineStarts.back() == size()) {
+        m_lineStarts.pop_back();
+    }
+
+    if (m_lineStarts.size() != before) {
+        emit indexProgress(lineCount());
+    }
+    if (finished && !m_indexComplete) {
+        m_indexComplete = true;
+        emit indexFinished();
+    }
+}
@@ -0,0 +1,72 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <QObject>
+#include <QString>
+#include <memory>
+#include <vector>
+
+/**
+ * @brief The MappedFile class
+ *        Read-only memory mapping of a file plus an index of line start offsets.
+ *        The index is built on a worker thread in chunks, so the first lines are
+ *        available long before the whole file has been scanned.
+ */
+class MappedFile : public QObject {
+    Q_OBJECT
+
+   public:
+    explicit MappedFile(QObject* parent = nullptr);
+    ~MappedFile() override;  // Cancels indexing and releases the mapping
+
+    /**
+     * @brief Maps the file and starts building the line index in the background.
+     * @param path The file to map.
+     * @return false if the file cannot be opened or mapped.
+     */
+    bool open(const QString& path);
+
+    QString filePath() const { return m_path; }
+    const char* data() const;
+    qint64 size() const;
+
+    qint64 lineCount() const { return static_cast<qint64>(m_lineStarts.size()); }  // Lines indexed so far
+    bool isIndexComplete() const { return m_indexComplete; }
+
+    qint64 lineStart(qint64 line) const;  // Byte offset of the first character of the line
+    qint64 lineEnd(qint64 line) const;    // Byte offset past the last character, excluding the line break
+    qint64 lineAt(qint64 offset) const;   // Line the byte at offset belongs to, among the lines indexed so far
+
+    // Number of line breaks in the bytes [begin, end); exact once the index is complete
+    qint64 newlinesBetween(qint64 begin, qint64 end) const;
+
+    /**
+     * @brief Decodes one line as UTF-8.
+     * @param line Zero-based line number.
+     * @param maxBytes Decoding stops after this many bytes, which keeps huge single-line files cheap.
+     */
+    QString lineText(qint64 line, qint64 maxBytes = 64 * 1024) const;
+
+    /**
+     * @brief Appends the start offset of every line beginning in [begin, end) to out.
+     *        Uses SSE2 to test 16 bytes per step where available.
+     */
+    static void scanNewlines(const char* data, qint64 begin, qint64 end, std::vector<qint64>& out);
+
+   signals:
+    void indexProgress(qint64 lineCount);  // Emitted whenever more lines have been indexed
+    void indexFinished();                  // Emitted once the whole file has been indexed
+
+   private:
+    struct Mapping;  // Mapping and indexing state shared with the worker thread
+
+    void startIndexing();
+    void drainIndexedLines();
+
+    QString m_path;
+    std::shared_ptr<Mapping> m_mapping;
+    std::vector<qint64> m_lineStarts;  // Line start offsets indexed so far
+    bool m_indexComplete = false;
+};
+
+#endif  // MAPPEDFILE_H
@@ -0,0 +1,270 @@
+#include "minimap.h"
+#include "editorwidget.h"
+#include "trace.h"
+#include <QCoreApplication>
+#include <QMouseEvent>
+#include <QPainter>
+#include <QScrollBar>
+#include <QTextBlock>
+#include <QTextDocument>
+#include <QTextLayout>
+#include <QThreadPool>
+#include <algorithm>
+#include <climits>
+
+struct Minimap::State {
+    Minimap* owner = nullptr;  // Only touched on the GUI thread
+};
+
+namespace {
+
+// A run of characters with its own text color
+struct ColorSpan {
+    int start = 0;
+    int end = 0;
+    QRgb color = 0;
+};
+
+// What a worker needs to draw one line: its text, cut to the map width, and its colored ranges
+struct LineSnapshot {
+    QString text;
+    QVector<ColorSpan> spans;
+};
+
+QRgb fade(QRgb color, QRgb background) {
+    return qRgb((qRed(color) * 3 + qRed(background)) / 4, (qGreen(color) * 3 + qGreen(background)) / 4, (qBlue(color) * 3 + qBlue(background)) / 4);
+}
+
+// Draws every non-blank character as one pixel in its syntax color, one row per line
+QImage renderTile(const QVector<LineSnapshot>& lines, QRgb background, QRgb foreground) {
+    constexpr int TabWidth = 4;
+
+    QImage image(Minimap::MapWidth, qMax(1, static_cast<int>(lines.size())), QImage::Format_RGB32);
+    image.fill(background);
+    const QRgb plain = fade(foreground, background);
+
+    for (int row = 0; row < lines.size(); ++row) {
+        QRgb* pixels = reinterpret_cast<QRgb*>(image.scanLine(row));
+        const LineSnapshot& line = lines[row];
+        int span = 0;
+        int x = 0;
+        for (int i = 0; i < line.text.size() && x < Minimap::MapWidth; ++i) {
+            const QChar c = line.text[i];
+            if (c == QLatin1Char('\t')) {
+                x = (x / TabWidth + 1) * TabWidth;
+                continue;
+            }
+            if (!c.isSpace()) {
+                while (span < line.spans.size() && line.spans[span].end <= i) {
+                    ++span;
+                }
+                const bool colored = span < line.spans.size() && line.spans[span].start <= i;
+                pixels[x] = colored ? fade(line.spans[span].color, background) : plain;
+            }
+            ++x;
+        }
+    }
+    return image;
+}
+
+}  // namespace
+
+Minimap::Minimap(MyPlainTextEdit* edit, QWidget* parent) : QWidget(parent), m_edit(edit) {
+    m_state = std::make_shared<State>();
+    m_state->owner = this;
+
+    setAttribute(Qt::WA_OpaquePaintEvent);
+    setFixedWidth(MapWidth);
+    setCursor(Qt::PointingHandCursor);
+
+    m_blockCount = edit->document()->blockCount();
+    m_renderTimer.setSingleShot(true);
+    m_renderTimer.setInterval(RenderDelayMs);
+    connect(&m_renderTimer, &QTimer::timeout, this, &Minimap::renderTiles);
+
+    connect(edit->document(), &QTextDocument::contentsChange, this, &Minimap::onContentsChange);
+    connect(edit->verticalScrollBar(), &QScrollBar::valueChanged, this, qOverload<>(&QWidget::update));
+}
+
+Minimap::~Minimap() {
+    m_state->owner = nullptr;
+}
+
+QSize Minimap::sizeHint() const {
+    return QSize(MapWidth, 0);
+}
+
+int Minimap::visibleLineCount() const {
+    return qMax(1, m_edit->viewport()->height() / qMax(1, m_edit->fontMetrics().lineSpacing()));
+}
+
+int Minimap::firstMapLine() const {
+    // A document taller than the map scrolls through it in proportion to the editor
+    const int total = m_edit->document()->blockCount();
+    const int rows = height() / RowHeight;
+    if (total <= rows) {
+        return 0;
+    }
+    const int maxFirst = qMax(1, total - visibleLineCount());
+    const int first = qMin(m_edit->firstVisibleBlock().blockNumber(), maxFirst);
+    return static_cast<int>(static_cast<qint64>(total - rows) * first / maxFirst);
+}
+
+void Minimap::visibleTiles(int* first, int* last) const {
+    const int mapFirst = firstMapLine();
+    const int lastLine = qMin(mapFirst + height() / RowHeight, m_edit->document()->blockCount() - 1);
+    *first = mapFirst / TileLines;
+    *last = qMax(*first, lastLine / TileLines);
+}
+
+void Minimap::onContentsChange(int from, int, int charsAdded) {
+    // Format changes from the highlighter arrive here as well, and recolor their lines just like edits do
+    QTextDocument* doc = m_edit->document();
+    const int firstTile = doc->findBlock(from).blockNumber() / TileLines;
+    int lastTile = doc->findBlock(from + charsAdded).blockNumber() / TileLines;
+    if (doc->blockCount() != m_blockCount) {
+        m_blockCount = doc->blockCount();
+        lastTile = INT_MAX;  // Every line below moved
+        update();
+    }
+
+    for (auto it = m_tiles.begin(); it != m_tiles.end(); ++it) {
+        if (it.key() >= firstTile && it.key() <= lastTile) {
+            ++it->version;
+        }
+    }
+
+    // Not restarted by later edits, so background highlighting cannot hold the render back forever
+    if (!m_renderTimer.isActive()) {
+        m_renderTimer.start();
+    }
+}
+
+void Minimap::renderTiles() {
+    int first = 0;
+    int last = 0;
+    visibleTiles(&first, &last);
+
+    for (auto it = m_tiles.begin(); it != m_tiles.end();) {
+        if (it.key() < first - KeptTiles || it.key() > last + KeptTiles) {
+            it = m_tiles.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+
+    for (int index = first; index <= last; ++index) {
+        const Tile& tile = m_tiles[index];
+        if (tile.renderedVersion != tile.version && tile.requestedVersion != tile.version) {
+            requestTile(index);
+        }
+    }
+}
+
+void Minimap::requestTile(int index) {
+    Tile& tile = m_tiles[index];
+    tile.requestedVersion = tile.version;
+
+    // Text and formats are read from the blocks as they are; the document is never asked to lay anything out
+    QVector<LineSnapshot> lines;
+    lines.reserve(TileLines);
+    QTextBlock block = m_edit->document()->findBlockByNumber(index * TileLines);
+    for (int i = 0; i < TileLines && block.isValid(); ++i, block = block.next()) {
+        LineSnapshot line;
+        line.text = block.text().left(MapWidth);
+        for (const QTextLayout::FormatRange& range : block.layout()->formats()) {
+            if (range.format.hasProperty(QTextFormat::ForegroundBrush) && range.start < line.text.size()) {
+                line.spans.append({range.start, range.start + range.length, range.format.foreground().color().rgb()});
+            }
+        }
+        std::sort(line.spans.begin(), line.spans.end(), [](const ColorSpan& a, const ColorSpan& b) { return a.start < b.start; });
+        lines.append(line);
+    }
+
+    std::shared_ptr<State> state = m_state;
+    const quint64 version = tile.version;
+    const QRgb background = m_edit->palette().color(QPalette::Base).rgb();
+    const QRgb foreground = m_edit->palette().color(QPalette::Text).rgb();
+
+    QThreadPool::globalInstance()->start([state, index, version, lines, background, foreground]() {
+        TRACE_SCOPE("Minimap tile render");
+        const QImage image = renderTile(lines, background, foreground);
+
+        std::weak_ptr<State> weak = state;
+        QMetaObject::invokeMethod(
+            QCoreApplication::instance(),
+            [weak, index, version, image]() {
+                std::shared_ptr<State> s = weak.lock();
+                if (s && s->owner) {
+                    s->owner->onTileRendered(index, version, image);
+                }
+            },
+            Qt::QueuedConnection);
+    });
+}
+
+void Minimap::onTileRendered(int index, quint64 version, const QImage& image) {
+    auto it = m_tiles.find(index);
+    if (it == m_tiles.end() || version < it->renderedVersion) {
+        return;
+    }
+
+    // An image that an edit has already outdated still beats an empty tile until its replacement arrives
+    it->image = image;
+    it->renderedVersion = version;
+    if (version != it->version && !m_renderTimer.isActive()) {
+        m_renderTimer.start();
+    }
+    update();
+}
+
+void Minimap::paintEvent(QPaintEvent* event) {
+    TRACE_SCOPE("Minimap::paintEvent");
+    QPainter painter(this);
+    painter.fillRect(event->rect(), m_edit->palette().color(QPalette::Base));
+
+    const int mapFirst = firstMapLine();
+    int first = 0;
+    int last = 0;
+    visibleTiles(&first, &last);
+
+    bool missing = false;
+    for (int index = first; index <= last; ++index) {
+        auto it = m_tiles.constFind(index);
+        if (it == m_tiles.constEnd() || it->image.isNull()) {
+            missing = true;
+            continue;
+        }
+        const int y = (index * TileLines - mapFirst) * RowHeight;
+        painter.drawImage(QRect(0, y, it->image.width(), it->image.height() * RowHeight), it->image);
+    }
+
+    // The part of the document the editor shows
+    const int firstVisible = m_edit->firstVisibleBlock().blockNumber();
+    QColor shade = m_edit->palette().color(QPalette::Text);
+    shade.setAlpha(40);
+    painter.fillRect(QRect(0, (firstVisible - mapFirst) * RowHeight, width(), visibleLineCount() * RowHeight), shade);
+
+    // Tiles scrolled into view are requested right away; only dirty ones wait for the timer
+    if (missing) {
+        renderTiles();
+    }
+}
+
+void Minimap::mousePressEvent(QMouseEvent* event) {
+    if (event->button() == Qt::LeftButton) {
+        scrollToY(event->position().toPoint().y());
+    }
+}
+
+void Minimap::mouseMoveEvent(QMouseEvent* event) {
+    if (event->buttons() & Qt::LeftButton) {
+        scrollToY(event->position().toPoint().y());
+    }
+}
+
+void Minimap::scrollToY(int y) {
+    const int line = firstMapLine() + qMax(0, y) / RowHeight;
+    m_edit->verticalScrollBar()->setValue(line - visibleLineCount() / 2);
+}
@@ -0,0 +1,66 @@
+#ifndef MINIMAP_H
+#define MINIMAP_H
+
+#include <QHash>
+#include <QImage>
+#include <QTimer>
+#include <QWidget>
+#include <memory>
+
+class MyPlainTextEdit;
+
+/**
+ * @brief The Minimap class
+ *        Zoomed-out, syntax-colored overview of a document beside its editor. The
+ *        document is drawn from tiles holding one pixel row per line; a tile is
+ *        rendered on a worker thread from a snapshot of its lines' text and formats,
+ *        and only tiles whose lines an edit touched are rendered again. Only tiles
+ *        in view are ever built, and nothing here asks the document for a layout.
+ */
+class Minimap : public QWidget {
+    Q_OBJECT
+
+   public:
+    explicit Minimap(MyPlainTextEdit* edit, QWidget* parent = nullptr);
+    ~Minimap() override;  // Drops the tiles that are still being rendered
+
+    QSize sizeHint() const override;
+
+    static constexpr int TileLines = 256;      // Lines per tile
+    static constexpr int MapWidth = 100;       // Width in pixels, which is also the number of columns drawn
+    static constexpr int RowHeight = 2;        // Height each line is shown at
+    static constexpr int RenderDelayMs = 100;  // Quiet time after edits before dirty tiles are rendered again
+    static constexpr int KeptTiles = 8;        // Tiles kept on either side of the visible ones
+
+   protected:
+    void paintEvent(QPaintEvent* event) override;
+    void mousePressEvent(QMouseEvent* event) override;
+    void mouseMoveEvent(QMouseEvent* event) override;
+
+   private:
+    struct State;  // Shared with the workers so it outlives a minimap deleted mid-job
+
+    struct Tile {
+        QImage image;                   // Null until the first render arrives
+        quint64 version = 1;            // Bumped whenever an edit touches the tile's lines
+        quint64 renderedVersion = 0;    // Version the image shows
+        quint64 requestedVersion = 0;   // Version last handed to a worker
+    };
+
+    int firstMapLine() const;                        // Document line shown at the top of the map
+    int visibleLineCount() const;                    // Lines the editor's viewport shows
+    void visibleTiles(int* first, int* last) const;  // Range of tiles the map shows
+    void onContentsChange(int from, int charsRemoved, int charsAdded);
+    void renderTiles();  // Drops far-away tiles and requests every visible one that is missing or dirty
+    void requestTile(int index);
+    void onTileRendered(int index, quint64 version, const QImage& image);
+    void scrollToY(int y);  // Centers the editor on the line under y
+
+    MyPlainTextEdit* m_edit;
+    std::shared_ptr<State> m_state;
+    QHash<int, Tile> m_tiles;  // By tile index, only around the visible part of the map
+    QTimer m_renderTimer;
+    int m_blockCount = 0;  // Block count at the last edit, to tell edits that shift the lines below
+};
+
+#endif  // MINIMAP_H
@@ -0,0 +1,272 @@
+#include "multidocumentsearch.h"
+#include "editorwidget.h"
+#include "highlightscheduler.h"
+#include "textsearch.h"
+#include <QCoreApplication>
+#include <QPlainTextEdit>
+#include <QRegularExpression>
+#include <QTextCursor>
+#include <QTextDocument>
+#include <QThreadPool>
+
+struct MultiDocumentSearch::State {
+    MultiDocumentSearch* owner = nullptr;  // Only touched on the GUI thread
+};
+
+namespace {
+
+// Deferred tabs of a restored session hold an empty document until they are first shown
+QPlainTextEdit* searchableEdit(EditorWidget* editor) {
+    return editor && !editor->isLargeFileMode() && !editor->isLoading() && !editor->isDeferredLoad() ? editor->textEdit() : nullptr;
+}
+
+// A followed tab is read-only, which edits through QTextCursor would not respect
+QPlainTextEdit* replaceableEdit(EditorWidget* editor) {
+    return editor && !editor->isFollowing() ? searchableEdit(editor) : nullptr;
+}
+
+}  // namespace
+
+MultiDocumentSearch::MultiDocumentSearch(QObject* parent) : QObject(parent) {
+    m_state = std::make_shared<State>();
+    m_state->owner = this;
+}
+
+MultiDocumentSearch::~MultiDocumentSearch() {
+    cancel();
+    m_state->owner = nullptr;
+}
+
+QVector<MultiDocumentSearch::Hit> MultiDocumentSearch::describeMatches(QStringView text, const QVector<int>& starts, const QVector<int>& lengths, int length, QChar lineBreak) {
+    QVector<Hit> hits;
+    hits.reserve(starts.size());
+
+    int line = 0;
+    qsizetype lineStart = 0;
+    qsizetype lineEnd = text.indexOf(lineBreak);
+    if (lineEnd < 0) {
+        lineEnd = text.size();
+    }
+
+    for (int i = 0; i < starts.size(); ++i) {
+        const qsizetype start = starts[i];
+        while (start > lineEnd && lineEnd < text.size()) {
+            lineStart = lineEnd + 1;
+            ++line;
+            lineEnd = text.indexOf(lineBreak, lineStart);
+            if (lineEnd < 0) {
+                lineEnd = text.size();
+            }
+        }
+
+        Hit hit;
+        hit.position = starts[i];
+        hit.length = lengths.isEmpty() ? length : lengths[i];
+        hit.line = line;
+        hit.column = static_cast<int>(start - lineStart);
+
+        const qsizetype from = hit.column > PreviewContext ? start - PreviewContext : lineStart;
+        hit.preview = text.sliced(from, qMin<qsizetype>(lineEnd - from, PreviewLength)).toString();
+        if (from > lineStart) {
+            hit.preview.prepend(QChar(0x2026));
+        }
+        hits.append(hit);
+    }
+    return hits;
+}
+
+void MultiDocumentSearch::cancel() {
+    if (m_job) {
+        *m_job = true;
+        m_job.reset();
+    }
+    ++m_generation;
+    m_targets.clear();
+    m_pending = 0;
+}
+
+bool MultiDocumentSearch::start(const QString& pattern, Qt::CaseSensitivity cs, bool regex) {
+    cancel();
+    m_error.clear();
+    if (pattern.isEmpty()) {
+        return false;
+    }
+    if (regex) {
+        const QRegularExpression re = TextSearch::regex(pattern, cs);
+        if (!re.isValid()) {
+            m_error = re.errorString();
+            return false;
+        }
+    }
+    m_job = std::make_shared<std::atomic<bool>>(false);
+    return true;
+}
+
+bool MultiDocumentSearch::search(const QList<EditorWidget*>& editors, const QString& pattern, Qt::CaseSensitivity cs, bool regex) {
+    if (!start(pattern, cs, regex)) {
+        return false;
+    }
+
+    std::shared_ptr<State> state = m_state;
+    std::shared_ptr<std::atomic<bool>> cancelled = m_job;
+    const quint64 generation = m_generation;
+    const QRegularExpression re = regex ? TextSearch::regex(pattern, cs) : QRegularExpression();
+    const QString needle = cs == Qt::CaseSensitive ? pattern : TextSearch::fold(pattern);
+
+    for (EditorWidget* editor : editors) {
+        QPlainTextEdit* edit = searchableEdit(editor);
+        if (!edit) {
+            reportSkipped(editor);
+            continue;
+        }
+        const int index = m_targets.size();
+        m_targets.append({editor, editor->highlightScheduler()->revision()});
+        ++m_pending;
+
+        // The snapshot is the only part of the document the job sees
+        const QString text = edit->document()->toRawText();
+        QThreadPool::globalInstance()->start([state, cancelled, generation, index, text, needle, cs, regex, re]() {
+            QVector<int> starts;
+            QVector<int> lengths;
+            if (regex) {
+                TextSearch::findAll(TextSearch::withLineBreaks(text), re, 0, text.size(), MaxHitsPerDocument, starts, lengths, cancelled.get());
+            }
+            else {
+                const QString haystack = cs == Qt::CaseSensitive ? text : TextSearch::fold(text);
+                starts = TextSearch::findAll(haystack, needle, MaxHitsPerDocument, cancelled.get());
+            }
+            if (*cancelled) {
+                return;
+            }
+
+            const QVector<Hit> hits = describeMatches(text, starts, lengths, static_cast<int>(needle.size()));
+            const bool capped = starts.size() >= MaxHitsPerDocument;
+            std::weak_ptr<State> weak = state;
+            QMetaObject::invokeMethod(
+                QCoreApplication::instance(),
+                [weak, generation, index, hits, capped]() {
+                    std::shared_ptr<State> s = weak.lock();
+                    if (s && s->owner) {
+                        s->owner->onSearched(generation, index, hits, capped);
+                    }
+                },
+                Qt::QueuedConnection);
+        });
+    }
+
+    if (m_pending == 0) {
+        emit finished();
+    }
+    return true;
+}
+
+bool MultiDocumentSearch::replaceAll(const QList<EditorWidget*>& editors, const QString& pattern, Qt::CaseSensitivity cs, bool regex, const QString& replacement) {
+    if (!start(pattern, cs, regex)) {
+        return false;
+    }
+
+    std::shared_ptr<State> state = m_state;
+    std::shared_ptr<std::atomic<bool>> cancelled = m_job;
+    const quint64 generation = m_generation;
+    const QRegularExpression re = regex ? TextSearch::regex(pattern, cs) : QRegularExpression();
+    const QString needle = cs == Qt::CaseSensitive ? pattern : TextSearch::fold(pattern);
+
+    for (EditorWidget* editor : editors) {
+        QPlainTextEdit* edit = replaceableEdit(editor);
+        if (!edit) {
+            reportSkipped(editor);
+            continue;
+        }
+        const int index = m_targets.size();
+        m_targets.append({editor, editor->highlightScheduler()->revision()});
+        ++m_pending;
+
+        const QString text = edit->document()->toRawText();
+        QThreadPool::globalInstance()->start([state, cancelled, generation, index, text, needle, cs, regex, re, replacement]() {
+            TextSearch::Replacement result;
+            if (regex) {
+                result = TextSearch::replaceAll(TextSearch::withLineBreaks(text), re, 0, text.size(), replacement, cancelled.get());
+            }
+            else {
+                const QString haystack = cs == Qt::CaseSensitive ? text : TextSearch::fold(text);
+                result = TextSearch::replaceAll(text, haystack, needle, replacement);
+            }
+            if (*cancelled) {
+                return;
+            }
+
+            std::weak_ptr<State> weak = state;
+            QMetaObject::invokeMethod(
+                QCoreApplication::instance(),
+                [weak, generation, index, result]() {
+                    std::shared_ptr<State> s = weak.lock();
+                    if (s && s->owner) {
+                        s->owner->onReplaced(generation, index, result.start, result.end, result.text, result.count);
+                    }
+                },
+                Qt::QueuedConnection);
+        });
+    }
+
+    if (m_pending == 0) {
+        emit finished();
+    }
+    return true;
+}
+
+void MultiDocumentSearch::reportSkipped(EditorWidget* editor) {
+    if (editor && editor->isDeferredLoad()) {
+        emit documentSkipped(editor, tr("Not loaded; show the tab to search it"));
+    }
+    else if (editor && editor->isFollowing()) {
+        emit documentSkipped(editor, tr("Read-only while following the file"));
+    }
+}
+
+void MultiDocumentSearch::onSearched(quint64 generation, int index, const QVector<Hit>& hits, bool capped) {
+    if (generation != m_generation) {
+        return;
+    }
+    if (EditorWidget* editor = m_targets[index].editor) {
+        emit documentSearched(editor, hits, capped);
+    }
+    if (generation == m_generation) {  // A receiver may have started another request
+        jobDone();
+    }
+}
+
+void MultiDocumentSearch::onReplaced(quint64 generation, int index, qsizetype start, qsizetype end, const QString& text, int count) {
+    if (generation != m_generation) {
+        return;
+    }
+
+    // Offsets are only valid for the snapshot, so a document edited since then is left alone
+    const Target target = m_targets[index];
+    if (EditorWidget* editor = target.editor) {
+        QPlainTextEdit* edit = replaceableEdit(editor);
+        if (!edit || editor->highlightScheduler()->revision() != target.revision) {
+            emit documentReplaced(editor, -1);
+        }
+        else {
+            if (count > 0) {
+                QTextCursor cursor(edit->document());
+                cursor.setPosition(static_cast<int>(start));
+                cursor.setPosition(static_cast<int>(end), QTextCursor::KeepAnchor);
+                cursor.beginEditBlock();
+                cursor.insertText(text);
+                cursor.endEditBlock();
+            }
+            emit documentReplaced(editor, count);
+        }
+    }
+    if (generation == m_generation) {
+        jobDone();
+    }
+}
+
+void MultiDocumentSearch::jobDone() {
+    if (--m_pending == 0) {
+        m_job.reset();
+        emit finished();
+    }
+}
@@ -0,0 +1,94 @@
+#ifndef MULTIDOCUMENTSEARCH_H
+#define MULTIDOCUMENTSEARCH_H
+
+#include <QList>
+#include <QObject>
+#include <QPointer>
+#include <QString>
+#include <QVector>
+#include <atomic>
+#include <memory>
+
+class EditorWidget;
+
+/**
+ * @brief The MultiDocumentSearch class
+ *        Searches or replaces in every open tab at once. The text of each document is
+ *        snapshotted on the GUI thread and handed to its own job on the global thread
+ *        pool, so the work spreads over all cores, and each document's result is
+ *        reported as soon as its job is done. Replacements are applied as one edit
+ *        block per document, and dropped for documents edited in the meantime.
+ */
+class MultiDocumentSearch : public QObject {
+    Q_OBJECT
+
+   public:
+    // One match, with the line it starts on for display
+    struct Hit {
+        int position = 0;  // Offset of the match in the document
+        int length = 0;
+        int line = 0;      // Block number of the match
+        int column = 0;    // Offset of the match in its block
+        QString preview;   // The start of the line, or the text around the match in a long line
+    };
+
+    explicit MultiDocumentSearch(QObject* parent = nullptr);
+    ~MultiDocumentSearch() override;  // Drops the results of jobs that are still running
+
+    /**
+     * @brief Finds every match of pattern in the given editors.
+     *        Large file viewers and tabs that are still loading are skipped; tabs a restored
+     *        session has not loaded yet are reported through documentSkipped().
+     * @return false if pattern is empty or not a valid regular expression; nothing is reported then.
+     */
+    bool search(const QList<EditorWidget*>& editors, const QString& pattern, Qt::CaseSensitivity cs, bool regex);
+
+    // Replaces every match of pattern in the given editors, expanding capture group references in regex mode;
+    // followed tabs are read-only and reported through documentSkipped()
+    bool replaceAll(const QList<EditorWidget*>& editors, const QString& pattern, Qt::CaseSensitivity cs, bool regex, const QString& replacement);
+
+    /**
+     * @brief Adds line, column and preview to matches, walking the lines of text once.
+     * @param lengths The length of each match, or empty if every match is length long.
+     * @param lineBreak QChar::ParagraphSeparator for a raw document snapshot, \n for file contents.
+     */
+    static QVector<Hit> describeMatches(QStringView text, const QVector<int>& starts, const QVector<int>& lengths, int length, QChar lineBreak = QChar::ParagraphSeparator);
+
+    void cancel();  // Drops the results of the running search or replacement
+    bool isRunning() const { return m_pending > 0; }
+    QString errorString() const { return m_error; }  // Why the regular expression of the last request is invalid, if it is
+
+    static constexpr int MaxHitsPerDocument = 10000;  // Matches reported per document
+    static constexpr int PreviewLength = 160;         // Characters of a line shown with a match
+    static constexpr int PreviewContext = 40;         // Characters kept before a match that lies far into its line
+
+   signals:
+    void documentSearched(EditorWidget* editor, const QVector<MultiDocumentSearch::Hit>& hits, bool capped);
+    void documentReplaced(EditorWidget* editor, int count);  // count is -1 if the document was edited in the meantime
+    void documentSkipped(EditorWidget* editor, const QString& reason);  // Emitted while the request starts, for tabs it cannot cover
+    void finished();                                          // Every document of the last request was reported
+
+   private:
+    struct State;  // Shared with the workers so it outlives a search deleted mid-job
+
+    // A document the running request snapshotted
+    struct Target {
+        QPointer<EditorWidget> editor;
+        quint64 revision = 0;  // Edit revision of the document when it was snapshotted
+    };
+
+    bool start(const QString& pattern, Qt::CaseSensitivity cs, bool regex);  // Cancels the previous request and validates the pattern
+    void reportSkipped(EditorWidget* editor);  // Tells the user about a tab left out that they would expect to be covered
+    void onSearched(quint64 generation, int index, const QVector<Hit>& hits, bool capped);
+    void onReplaced(quint64 generation, int index, qsizetype start, qsizetype end, const QString& text, int count);
+    void jobDone();
+
+    std::shared_ptr<State> m_state;
+    std::shared_ptr<std::atomic<bool>> m_job;  // Cancellation flag shared by the jobs of the running request
+    QList<Target> m_targets;
+    quint64 m_generation = 0;  // Bumped by every request; results of older ones are dropped
+    int m_pending = 0;         // Jobs of the running request that have not reported yet
+    QString m_error;
+};
+
+#endif  // MULTIDOCUMENTSEARCH_H
@@ -0,0 +1,279 @@
+#include "piecetable.h"
+#include "mappedfile.h"
+#include "trace.h"
+#include <QSaveFile>
+#include <algorithm>
+#include <cstring>
+
+PieceTable::PieceTable(const MappedFile* original) : m_original(original), m_random(0x7e77) {
+    if (original->size() > 0) {
+        m_root = leaf({false, 0, original->size(), original->newlinesBetween(0, original->size())});
+    }
+    m_savedRoot = m_root;
+}
+
+qint64 PieceTable::size() const {
+    return m_root ? m_root->length : 0;
+}
+
+qint64 PieceTable::lineCount() const {
+    return (m_root ? m_root->newlines : 0) + 1;
+}
+
+const char* PieceTable::bytes(const Piece& piece) const {
+    return (piece.added ? m_added.constData() : m_original->data()) + piece.start;
+}
+
+PieceTable::Piece PieceTable::slice(const Piece& piece, qint64 from, qint64 length) const {
+    Piece part{piece.added, piece.start + from, length, 0};
+    if (piece.added) {
+        const char* begin = m_added.constData() + part.start;
+        part.newlines = std::count(begin, begin + length, '\n');
+    }
+    else {
+        // The original's line index answers this without touching the mapped bytes
+        part.newlines = m_original->newlinesBetween(part.start, part.start + length);
+    }
+    return part;
+}
+
+qint64 PieceTable::nthNewline(const Piece& piece, qint64 n) const {
+    if (!piece.added) {
+        // The nth break ends the (n - 1)th line after the one the piece starts in
+        return m_original->lineStart(m_original->lineAt(piece.start) + n) - 1 - piece.start;
+    }
+    const char* begin = bytes(piece);
+    const char* at = begin - 1;
+    for (qint64 i = 0; i < n; ++i) {
+        at = static_cast<const char*>(std::memchr(at + 1, '\n', static_cast<size_t>(begin + piece.length - at - 1)));
+    }
+    return at - begin;
+}
+
+PieceTable::NodePtr PieceTable::makeNode(const Piece& piece, quint32 priority, NodePtr left, NodePtr right) const {
+    auto node = std::make_shared<Node>();
+    node->piece = piece;
+    node->priority = priority;
+    node->length = piece.length + (left ? left->length : 0) + (right ? right->length : 0);
+    node->newlines = piece.newlines + (left ? left->newlines : 0) + (right ? right->newlines : 0);
+    node->left = std::move(left);
+    node->right = std::move(right);
+    return node;
+}
+
+PieceTable::NodePtr PieceTable::leaf(const Piece& piece) {
+    return makeNode(piece, m_random.generate(), nullptr, nullptr);
+}
+
+std::pair<PieceTable::NodePtr, PieceTable::NodePtr> PieceTable::split(const NodePtr& node, qint64 offset) const {
+    if (!node) {
+        return {};
+    }
+    const qint64 leftLength = node->left ? node->left->length : 0;
+    if (offset <= leftLength) {
+        auto [first, rest] = split(node->left, offset);
+        return {first, makeNode(node->piece, node->priority, rest, node->right)};
+    }
+    offset -= leftLength;
+    if (offset >= node->piece.length) {
+        auto [first, rest] = split(node->right, offset - node->piece.length);
+        return {makeNode(node->piece, node->priority, node->left, first), rest};
+    }
+
+    // The cut falls inside this piece, which becomes two; the halves keep the node's priority
+    const Piece head = slice(node->piece, 0, offset);
+    const Piece tail = slice(node->piece, offset, node->piece.length - offset);
+    return {merge(node->left, makeNode(head, node->priority, nullptr, nullptr)), merge(makeNode(tail, node->priority, nullptr, nullptr), node->right)};
+}
+
+PieceTable::NodePtr PieceTable::merge(const NodePtr& left, const NodePtr& right) {
+    if (!left) {
+        return right;
+    }
+    if (!right) {
+        return left;
+    }
+    auto join = [](const Node& node, NodePtr l, NodePtr r) {
+        auto joined = std::make_shared<Node>(node);
+        joined->length = node.piece.length + (l ? l->length : 0) + (r ? r->length : 0);
+        joined->newlines = node.piece.newlines + (l ? l->newlines : 0) + (r ? r->newlines : 0);
+        joined->left = std::move(l);
+        joined->right = std::move(r);
+        return NodePtr(joined);
+    };
+    if (left->priority > right->priority) {
+        return join(*left, left->left, merge(left->right, right));
+    }
+    return join(*right, merge(left, right->left), right->right);
+}
+
+template <typename Fn>
+void PieceTable::forEachPiece(const Node* node, qint64 base, qint64 from, qint64 to, Fn&& fn) {
+    if (!node || from >= base + node->length || to <= base) {
+        return;
+    }
+    const qint64 leftLength = node->left ? node->left->length : 0;
+    forEachPiece(node->left.get(), base, from, to, fn);
+    const qint64 start = base + leftLength;
+    if (from < start + node->piece.length && to > start) {
+        fn(node->piece, start);
+    }
+    forEachPiece(node->right.get(), start + node->piece.length, from, to, fn);
+}
+
+qint64 PieceTable::lineStart(qint64 line) const {
+    if (line <= 0) {
+        return 0;
+    }
+
+    // The line starts right after the line-th break
+    qint64 n = line;
+    qint64 base = 0;
+    const Node* node = m_root.get();
+    while (node) {
+        const qint64 leftNewlines = node->left ? node->left->newlines : 0;
+        if (n <= leftNewlines) {
+            node = node->left.get();
+            continue;
+        }
+        n -= leftNewlines;
+        base += node->left ? node->left->length : 0;
+        if (n <= node->piece.newlines) {
+            return base + nthNewline(node->piece, n) + 1;
+        }
+        n -= node->piece.newlines;
+        base += node->piece.length;
+        node = node->right.get();
+    }
+    return size();
+}
+
+qint64 PieceTable::lineEnd(qint64 line) const {
+    const qint64 start = lineStart(line);
+    qint64 end = line + 1 < lineCount() ? lineStart(line + 1) - 1 : size();
+    if (end > start && read(end - 1, 1) == "\r") {
+        --end;
+    }
+    return end;
+}
+
+qint64 PieceTable::lineAt(qint64 offset) const {
+    qint64 line = 0;
+    const Node* node = m_root.get();
+    while (node) {
+        const qint64 leftLength = node->left ? node->left->length : 0;
+        if (offset < leftLength) {
+            node = node->left.get();
+            continue;
+        }
+        offset -= leftLength;
+        line += node->left ? node->left->newlines : 0;
+        if (offset < node->piece.length) {
+            return line + slice(node->piece, 0, offset).newlines;
+        }
+        offset -= node->piece.length;
+        line += node->piece.newlines;
+        node = node->right.get();
+    }
+    return line;
+}
+
+QByteArray PieceTable::read(qint64 offset, qint64 length) const {
+    QByteArray out;
+    out.reserve(qMax<qint64>(0, length));
+    const qint64 end = offset + length;
+    forEachPiece(m_root.get(), 0, offset, end, [&](const Piece& piece, qint64 start) {
+        const qint64 from = qMax(offset, start);
+        const qint64 to = qMin(end, start + piece.length);
+        out.append(bytes(piece) + (from - start), to - from);
+    });
+    return out;
+}
+
+QString PieceTable::lineText(qint64 line, qint64 maxBytes) const {
+    if (line < 0 || line >= lineCount()) {
+        return QString();
+    }
+    const qint64 start = lineStart(line);
+    return QString::fromUtf8(read(start, qMin(lineEnd(line) - start, maxBytes)));
+}
+
+void PieceTable::insert(qint64 offset, const QByteArray& text) {
+    TRACE_SCOPE("PieceTable::insert");
+    if (text.isEmpty()) {
+        return;
+    }
+    offset = qBound<qint64>(0, offset, size());
+    if (!(m_mergeInsert && offset == m_mergeEnd)) {
+        pushUndo(offset);
+    }
+    m_mergeInsert = true;
+    m_mergeEnd = offset + text.size();
+
+    const Piece piece{true, m_added.size(), text.size(), text.count('\n')};
+    m_added.append(text);
+    auto [first, rest] = split(m_root, offset);
+    m_root = merge(merge(first, leaf(piece)), rest);
+}
+
+void PieceTable::remove(qint64 offset, qint64 length) {
+    TRACE_SCOPE("PieceTable::remove");
+    offset = qBound<qint64>(0, offset, size());
+    length = qMin(length, size() - offset);
+    if (length <= 0) {
+        return;
+    }
+
+    // Backspace ends where the last deletion began, Delete starts there
+    if (!(!m_mergeInsert && (offset + length == m_mergeEnd || offset == m_mergeEnd))) {
+        pushUndo(offset);
+    }
+    m_mergeInsert = false;
+    m_mergeEnd = offset;
+
+    auto [first, rest] = split(m_root, offset);
+    m_root = merge(first, split(rest, length).second);
+}
+
+void PieceTable::pushUndo(qint64 offset) {
+    m_undo.append({m_root, offset});
+    m_redo.clear();
+}
+
+qint64 PieceTable::undo() {
+    if (m_undo.isEmpty()) {
+        return 0;
+    }
+    const Version version = m_undo.takeLast();
+    m_redo.append({m_root, version.offset});
+    m_root = version.root;
+    m_mergeEnd = -1;
+    return version.offset;
+}
+
+qint64 PieceTable::redo() {
+    if (m_redo.isEmpty()) {
+        return 0;
+    }
+    const Version version = m_redo.takeLast();
+    m_undo.append({m_root, version.offset});
+    m_root = version.root;
+    m_mergeEnd = -1;
+    return version.offset;
+}
+
+bool PieceTable::save(const QString& path, QString* errorString) {
+    TRACE_SCOPE("PieceTable::save");
+    QSaveFile file(path);
+    bool ok = file.open(QIODevice::WriteOnly);
+    forEachPiece(m_root.get(), 0, 0, size(), [&](const Piece& piece, qint64) {
+        ok = ok && file.write(bytes(piece), piece.length) == piece.length;
+    });
+    if (!ok || !file.commit()) {
+        if (errorString)
+            *errorString = file.errorString();
+        return false;
+    }
+    m_savedRoot = m_root;
+    return true;
+}
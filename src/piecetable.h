@@ -0,0 +1,106 @@
+#ifndef PIECETABLE_H
+#define PIECETABLE_H
+
+#include <QByteArray>
+#include <QRandomGenerator>
+#include <QString>
+#include <QVector>
+#include <memory>
+
+class MappedFile;
+
+/**
+ * @brief The PieceTable class
+ *        Editable text over a memory-mapped file. The text is a sequence of pieces,
+ *        each a slice of either the unchanged file or an append-only buffer of
+ *        inserted bytes, kept in a treap that also sums up bytes and line breaks,
+ *        so finding an offset or a line takes logarithmic time. Tree nodes are never
+ *        changed, only replaced along the path to the root, which makes every
+ *        earlier version a root pointer: undo and redo keep roots, and memory grows
+ *        with the edits, never with the file. Offsets are in bytes of UTF-8.
+ */
+class PieceTable {
+   public:
+    // The whole of original as one piece; its line index must be complete
+    explicit PieceTable(const MappedFile* original);
+
+    qint64 size() const;       // Bytes of text
+    qint64 lineCount() const;  // Line breaks plus one, so a final line break is followed by an empty line
+
+    qint64 lineStart(qint64 line) const;  // Byte offset of the first character of the line
+    qint64 lineEnd(qint64 line) const;    // Byte offset past the last character, excluding the line break
+    qint64 lineAt(qint64 offset) const;   // Line the byte at offset belongs to
+
+    QByteArray read(qint64 offset, qint64 length) const;
+
+    // Decodes one line as UTF-8, stopping after maxBytes like MappedFile::lineText()
+    QString lineText(qint64 line, qint64 maxBytes = 64 * 1024) const;
+
+    // Edits; typing and deleting at the same spot merge into one undo step
+    void insert(qint64 offset, const QByteArray& bytes);
+    void remove(qint64 offset, qint64 length);
+
+    bool canUndo() const { return !m_undo.isEmpty(); }
+    bool canRedo() const { return !m_redo.isEmpty(); }
+    qint64 undo();  // Returns the offset the edit was made at, for the cursor
+    qint64 redo();
+
+    bool isModified() const { return m_root != m_savedRoot; }
+
+    /**
+     * @brief Streams the pieces into path through QSaveFile, so the text never needs to fit in memory.
+     *        Saving over the mapped file is safe: the mapping keeps the replaced file alive.
+     */
+    bool save(const QString& path, QString* errorString = nullptr);
+
+   private:
+    struct Piece {
+        bool added = false;   // In m_added rather than the original file
+        qint64 start = 0;     // Offset in its buffer
+        qint64 length = 0;
+        qint64 newlines = 0;  // Line breaks in the slice
+    };
+
+    struct Node;
+    using NodePtr = std::shared_ptr<const Node>;
+
+    struct Node {
+        Piece piece;
+        quint32 priority = 0;
+        NodePtr left;
+        NodePtr right;
+        qint64 length = 0;    // Bytes in the subtree
+        qint64 newlines = 0;  // Line breaks in the subtree
+    };
+
+    struct Version {
+        NodePtr root;
+        qint64 offset = 0;  // Where the edit leading away from this version was made
+    };
+
+    const char* bytes(const Piece& piece) const;               // First byte of the piece
+    Piece slice(const Piece& piece, qint64 from, qint64 length) const;
+    qint64 nthNewline(const Piece& piece, qint64 n) const;     // Offset in the piece of its nth line break, from 1
+
+    NodePtr makeNode(const Piece& piece, quint32 priority, NodePtr left, NodePtr right) const;
+    NodePtr leaf(const Piece& piece);
+    std::pair<NodePtr, NodePtr> split(const NodePtr& node, qint64 offset) const;  // First offset bytes, then the rest
+    static NodePtr merge(const NodePtr& left, const NodePtr& right);
+
+    template <typename Fn>
+    static void forEachPiece(const Node* node, qint64 base, qint64 from, qint64 to, Fn&& fn);  // Pieces overlapping [from, to)
+
+    void pushUndo(qint64 offset);  // Starts a new undo step for an edit at offset
+
+    const MappedFile* m_original;
+    QByteArray m_added;  // Every byte ever inserted, in order; pieces refer into it
+    NodePtr m_root;
+    NodePtr m_savedRoot;  // Version last loaded or saved
+    QVector<Version> m_undo;
+    QVector<Version> m_redo;
+    qint64 m_mergeEnd = -1;     // Offset where the next edit continues the last undo step, or -1
+    bool m_mergeInsert = false;  // The last undo step was typing rather than deleting
+    QRandomGenerator m_random;
+};
+
+#endif  // PIECETABLE_H
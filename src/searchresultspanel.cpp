@@ -0,0 +1,173 @@
+#include "searchresultspanel.h"
+#include "editorwidget.h"
+#include <QDir>
+#include <QHeaderView>
+#include <QLabel>
+#include <QTreeWidget>
+#include <QVBoxLayout>
+
+namespace {
+
+constexpr int EditorRole = Qt::UserRole;    // Index into m_editors, on top-level items of open tabs
+constexpr int PathRole = Qt::UserRole + 1;  // File path, on top-level items of Find in Files
+constexpr int PositionRole = Qt::UserRole + 2;
+constexpr int LengthRole = Qt::UserRole + 3;
+constexpr int LineRole = Qt::UserRole + 4;
+constexpr int ColumnRole = Qt::UserRole + 5;
+
+}  // namespace
+
+SearchResultsPanel::SearchResultsPanel(QWidget* parent) : QWidget(parent) {
+    QVBoxLayout* layout = new QVBoxLayout(this);
+    layout->setContentsMargins(0, 0, 0, 0);
+
+    m_status = new QLabel(this);
+    layout->addWidget(m_status);
+
+    m_tree = new QTreeWidget(this);
+    m_tree->setColumnCount(2);
+    m_tree->setHeaderLabels({tr("Location"), tr("Text")});
+    m_tree->header()->setSectionResizeMode(0, QHeaderView::ResizeToContents);
+    m_tree->setUniformRowHeights(true);
+    layout->addWidget(m_tree);
+
+    connect(m_tree, &QTreeWidget::itemActivated, this, &SearchResultsPanel::onItemActivated);
+}
+
+void SearchResultsPanel::beginSearch(const QString& pattern) {
+    m_tree->clear();
+    m_editors.clear();
+    m_pattern = pattern;
+    m_root.clear();
+    m_mode = Mode::SearchTabs;
+    m_count = 0;
+    m_documents = 0;
+    m_status->setText(tr("Searching for \"%1\"...").arg(pattern));
+}
+
+void SearchResultsPanel::beginReplace(const QString& pattern) {
+    beginSearch(pattern);
+    m_mode = Mode::ReplaceTabs;
+    m_status->setText(tr("Replacing \"%1\"...").arg(pattern));
+}
+
+void SearchResultsPanel::beginFileSearch(const QString& pattern, const QString& root) {
+    beginSearch(pattern);
+    m_mode = Mode::SearchFiles;
+    m_root = root;
+    m_status->setText(tr("Searching for \"%1\" in %2...").arg(pattern, QDir::toNativeSeparators(root)));
+}
+
+QTreeWidgetItem* SearchResultsPanel::addDocument(EditorWidget* editor, const QString& title) {
+    QTreeWidgetItem* item = new QTreeWidgetItem(m_tree);
+    item->setText(0, title);
+    item->setData(0, EditorRole, m_editors.size());
+    m_editors.append(editor);
+    return item;
+}
+
+void SearchResultsPanel::addMatches(EditorWidget* editor, const QString& title, const QVector<MultiDocumentSearch::Hit>& hits, bool capped) {
+    if (hits.isEmpty()) {
+        return;
+    }
+
+    addHits(addDocument(editor, title), hits, capped);
+}
+
+void SearchResultsPanel::addFileMatches(const QString& path, const QVector<MultiDocumentSearch::Hit>& hits, bool capped) {
+    if (hits.isEmpty()) {
+        return;
+    }
+
+    QTreeWidgetItem* document = new QTreeWidgetItem(m_tree);
+    document->setText(0, QDir::toNativeSeparators(QDir(m_root).relativeFilePath(path)));
+    document->setToolTip(0, QDir::toNativeSeparators(path));
+    document->setData(0, PathRole, path);
+    addHits(document, hits, capped);
+}
+
+void SearchResultsPanel::addHits(QTreeWidgetItem* document, const QVector<MultiDocumentSearch::Hit>& hits, bool capped) {
+    document->setText(1, capped ? tr("%1+ matches").arg(hits.size()) : tr("%n match(es)", nullptr, hits.size()));
+
+    QList<QTreeWidgetItem*> children;
+    children.reserve(hits.size());
+    for (const MultiDocumentSearch::Hit& hit : hits) {
+        QTreeWidgetItem* item = new QTreeWidgetItem;
+        item->setText(0, tr("%1:%2").arg(hit.line + 1).arg(hit.column + 1));
+        item->setText(1, hit.preview);
+        item->setData(0, PositionRole, hit.position);
+        item->setData(0, LengthRole, hit.length);
+        item->setData(0, LineRole, hit.line);
+        item->setData(0, ColumnRole, hit.column);
+        children.append(item);
+    }
+    document->addChildren(children);
+    document->setExpanded(m_mode != Mode::SearchFiles);  // A tree of files can list thousands; those start collapsed
+
+    m_count += hits.size();
+    ++m_documents;
+}
+
+void SearchResultsPanel::setProgress(qint64 filesSearched, qint64 bytesSearched) {
+    m_status->setText(tr("Searching for \"%1\"... %2 matches in %3 of %4 files (%5 MB)")
+                          .arg(m_pattern)
+                          .arg(m_count)
+                          .arg(m_documents)
+                          .arg(filesSearched)
+                          .arg(bytesSearched / (1024 * 1024)));
+}
+
+void SearchResultsPanel::addReplaced(EditorWidget* editor, const QString& title, int count) {
+    if (count == 0) {
+        return;
+    }
+
+    QTreeWidgetItem* document = addDocument(editor, title);
+    if (count < 0) {
+        document->setText(1, tr("Text changed, nothing replaced"));
+        return;
+    }
+    document->setText(1, tr("%n replaced", nullptr, count));
+    m_count += count;
+    ++m_documents;
+}
+
+void SearchResultsPanel::addSkipped(EditorWidget* editor, const QString& title, const QString& reason) {
+    addDocument(editor, title)->setText(1, reason);
+}
+
+void SearchResultsPanel::finish() {
+    if (m_mode == Mode::ReplaceTabs) {
+        m_status->setText(tr("Replaced %1 of \"%2\" in %n tab(s)", nullptr, m_documents).arg(m_count).arg(m_pattern));
+    }
+    else if (m_count == 0) {
+        m_status->setText(tr("No matches for \"%1\"").arg(m_pattern));
+    }
+    else if (m_mode == Mode::SearchFiles) {
+        m_status->setText(tr("%1 matches for \"%2\" in %n file(s)", nullptr, m_documents).arg(m_count).arg(m_pattern));
+    }
+    else {
+        m_status->setText(tr("%1 matches for \"%2\" in %n tab(s)", nullptr, m_documents).arg(m_count).arg(m_pattern));
+    }
+}
+
+void SearchResultsPanel::showError(const QString& message) {
+    m_tree->clear();
+    m_editors.clear();
+    m_status->setText(message);
+}
+
+void SearchResultsPanel::onItemActivated(QTreeWidgetItem* item) {
+    QTreeWidgetItem* document = item->parent();
+    if (!document) {
+        return;
+    }
+    if (m_mode == Mode::SearchFiles) {
+        emit fileMatchActivated(document->data(0, PathRole).toString(), item->data(0, LineRole).toInt(), item->data(0, ColumnRole).toInt());
+        return;
+    }
+    EditorWidget* editor = m_editors.value(document->data(0, EditorRole).toInt());
+    if (editor) {
+        emit matchActivated(editor, item->data(0, PositionRole).toInt(), item->data(0, LengthRole).toInt());
+    }
+}
@@ -0,0 +1,59 @@
+#ifndef SEARCHRESULTSPANEL_H
+#define SEARCHRESULTSPANEL_H
+
+#include <QList>
+#include <QPointer>
+#include <QWidget>
+
+#include "multidocumentsearch.h"
+
+class EditorWidget;
+class QLabel;
+class QTreeWidget;
+class QTreeWidgetItem;
+
+/**
+ * @brief The SearchResultsPanel class
+ *        Lists the results of a search across open tabs or files, grouped by tab or
+ *        file, as they stream in. Activating a match emits where it is so the window
+ *        can show it.
+ */
+class SearchResultsPanel : public QWidget {
+    Q_OBJECT
+
+   public:
+    explicit SearchResultsPanel(QWidget* parent = nullptr);
+
+    void beginSearch(const QString& pattern);                           // Clears the list for a new search
+    void beginReplace(const QString& pattern);                          // Clears the list for a Replace All across tabs
+    void beginFileSearch(const QString& pattern, const QString& root);  // Clears the list for Find in Files under root
+    void addMatches(EditorWidget* editor, const QString& title, const QVector<MultiDocumentSearch::Hit>& hits, bool capped);
+    void addReplaced(EditorWidget* editor, const QString& title, int count);  // count is -1 if nothing was replaced because the text changed
+    void addSkipped(EditorWidget* editor, const QString& title, const QString& reason);  // A tab the search or replacement left out
+    void addFileMatches(const QString& path, const QVector<MultiDocumentSearch::Hit>& hits, bool capped);
+    void setProgress(qint64 filesSearched, qint64 bytesSearched);  // Shows how far Find in Files has got
+    void finish();                                                 // Shows the totals
+    void showError(const QString& message);
+
+   signals:
+    void matchActivated(EditorWidget* editor, int position, int length);
+    void fileMatchActivated(const QString& path, int line, int column);  // line and column are zero-based
+
+   private:
+    void onItemActivated(QTreeWidgetItem* item);
+    QTreeWidgetItem* addDocument(EditorWidget* editor, const QString& title);
+    void addHits(QTreeWidgetItem* document, const QVector<MultiDocumentSearch::Hit>& hits, bool capped);
+
+    enum class Mode { SearchTabs, ReplaceTabs, SearchFiles };
+
+    QLabel* m_status = nullptr;
+    QTreeWidget* m_tree = nullptr;
+    QList<QPointer<EditorWidget>> m_editors;  // Editor of each top-level item, by index
+    QString m_pattern;
+    QString m_root;  // Directory file paths are shown relative to
+    Mode m_mode = Mode::SearchTabs;
+    int m_count = 0;      // Matches listed, or replaced
+    int m_documents = 0;  // Documents with at least one match
+};
+
+#endif  // SEARCHRESULTSPANEL_H
@@ -0,0 +1,73 @@
+#include "startupprofile.h"
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QEvent>
+#include <QTimer>
+#include <QVector>
+#include <QWidget>
+
+namespace {
+
+struct Mark {
+    const char* phase;
+    qint64 nsecs;  // Since start()
+};
+
+bool enabled = false;
+QElapsedTimer clock;
+QVector<Mark> marks;
+
+void report() {
+    qInfo().noquote() << "Startup profile (ms):";
+    qint64 previous = 0;
+    for (const Mark& mark : marks) {
+        qInfo().noquote() << QStringLiteral("  %1 %2 %3")
+                                 .arg(QString::fromLatin1(mark.phase), -28)
+                                 .arg((mark.nsecs - previous) / 1e6, 8, 'f', 2)
+                                 .arg(mark.nsecs / 1e6, 8, 'f', 2);
+        previous = mark.nsecs;
+    }
+}
+
+// Sees the widget's first paint event, then waits for the paint to finish before reporting
+class FirstPaintFilter : public QObject {
+   public:
+    using QObject::QObject;
+
+    bool eventFilter(QObject* watched, QEvent* event) override {
+        if (event->type() == QEvent::Paint) {
+            watched->removeEventFilter(this);
+            StartupProfile::mark("first paint event");
+            QTimer::singleShot(0, this, [this]() {
+                StartupProfile::mark("first paint done");
+                report();
+                deleteLater();
+            });
+        }
+        return false;
+    }
+};
+
+}  // namespace
+
+void StartupProfile::start() {
+    enabled = true;
+    marks.reserve(16);
+    clock.start();
+}
+
+bool StartupProfile::isEnabled() {
+    return enabled;
+}
+
+void StartupProfile::mark(const char* phase) {
+    if (enabled) {
+        marks.append({phase, clock.nsecsElapsed()});
+    }
+}
+
+void StartupProfile::watchFirstPaint(QWidget* widget) {
+    if (enabled && widget) {
+        widget->installEventFilter(new FirstPaintFilter(widget));
+    }
+}
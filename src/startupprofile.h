@@ -0,0 +1,20 @@
+#ifndef STARTUPPROFILE_H
+#define STARTUPPROFILE_H
+
+class QWidget;
+
+/**
+ * @brief The StartupProfile class
+ *        Timestamps of the phases of a cold start, from main() up to the first paint
+ *        of an editor, printed as a breakdown once that paint is done. Only recorded
+ *        when texxy runs with --startup-profile; otherwise every call returns at once.
+ */
+class StartupProfile {
+   public:
+    static void start();                           // Starts the clock; main() calls it first thing when profiling
+    static bool isEnabled();                       // start() has been called
+    static void mark(const char* phase);           // Records that phase ended now; phase must outlive the profile
+    static void watchFirstPaint(QWidget* widget);  // Marks the first paint of widget and prints the breakdown after it
+};
+
+#endif  // STARTUPPROFILE_H
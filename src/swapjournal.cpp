@@ -0,0 +1,326 @@
+#include "swapjournal.h"
+#include "trace.h"
+#include <QDataStream>
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QStringDecoder>
+#include <QTextDocument>
+#include <QUuid>
+
+#ifdef Q_OS_UNIX
+#include <unistd.h>
+#endif
+
+namespace {
+
+constexpr quint32 FormatVersion = 1;
+
+enum RecordType : quint8 {
+    HeaderRecord = 1,      // Format version, file path and the size and time of the file the edits apply to
+    CheckpointRecord = 2,  // The whole text; later edits apply to it instead of the file
+    EditRecord = 3,        // Position, removed length and inserted text
+};
+
+// Every record carries its length and a checksum, so a write torn by the crash ends recovery instead of corrupting it
+QByteArray frame(const QByteArray& payload) {
+    QByteArray record;
+    QDataStream out(&record, QIODevice::WriteOnly);
+    out << quint32(payload.size()) << qChecksum(payload);
+    out.writeRawData(payload.constData(), static_cast<int>(payload.size()));
+    return record;
+}
+
+template <typename... Fields>
+QByteArray makeRecord(RecordType type, const Fields&... fields) {
+    QByteArray payload;
+    QDataStream out(&payload, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_6_0);
+    out << quint8(type);
+    (out << ... << fields);
+    return frame(payload);
+}
+
+QByteArray headerRecord(const QString& filePath, qint64 baseSize, const QDateTime& baseTime) {
+    return makeRecord(HeaderRecord, FormatVersion, filePath, baseSize, baseTime.isValid() ? baseTime.toMSecsSinceEpoch() : qint64(-1));
+}
+
+bool syncToDisk(QFile& file) {
+    if (!file.flush()) {
+        return false;
+    }
+#ifdef Q_OS_UNIX
+    return ::fsync(file.handle()) == 0;
+#else
+    return true;
+#endif
+}
+
+}  // namespace
+
+SwapJournal::SwapJournal(QTextDocument* document, QObject* parent) : QObject(parent), m_document(document) {
+    m_flushTimer.setSingleShot(true);
+    m_flushTimer.setInterval(FlushDelayMs);
+    connect(&m_flushTimer, &QTimer::timeout, this, &SwapJournal::flush);
+}
+
+SwapJournal::~SwapJournal() {
+    close();
+}
+
+QString SwapJournal::journalDirectory() {
+    return QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + QStringLiteral("/swap");
+}
+
+void SwapJournal::reset(qint64 baseSize, const QDateTime& baseTime) {
+    m_flushTimer.stop();
+    m_pending.clear();
+    close();
+    m_needsCheckpoint = false;
+    m_baseSize = baseSize;
+    m_baseTime = baseTime;
+}
+
+void SwapJournal::record(int position, int charsRemoved, const QString& inserted) {
+    // Typing and backspacing arrive a character at a time; runs of them are written as one edit
+    if (!m_pending.isEmpty()) {
+        Edit& last = m_pending.last();
+        const int lastEnd = last.position + static_cast<int>(last.inserted.size());
+        if (charsRemoved == 0 && position == lastEnd) {
+            last.inserted += inserted;
+            return;
+        }
+        if (inserted.isEmpty() && position + charsRemoved == lastEnd && charsRemoved <= last.inserted.size()) {
+            last.inserted.chop(charsRemoved);
+            return;
+        }
+    }
+
+    m_pending.append({position, charsRemoved, inserted});
+    if (!m_flushTimer.isActive()) {
+        m_flushTimer.start();
+    }
+}
+
+bool SwapJournal::open() {
+    if (m_file.isOpen()) {
+        return true;
+    }
+
+    // The lock is held as long as this journal exists, so a running editor's journal is never taken for an orphan
+    if (m_journalPath.isEmpty()) {
+        if (!QDir().mkpath(journalDirectory())) {
+            return false;
+        }
+        const QString path = journalDirectory() + QLatin1Char('/') + QUuid::createUuid().toString(QUuid::WithoutBraces) + QStringLiteral(".swp");
+        auto lock = std::make_unique<QLockFile>(path + QStringLiteral(".lock"));
+        lock->setStaleLockTime(0);
+        if (!lock->tryLock(0)) {
+            return false;
+        }
+        m_journalPath = path;
+        m_lock = std::move(lock);
+    }
+
+    m_file.setFileName(m_journalPath);
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return false;
+    }
+    m_file.write(headerRecord(m_filePath, m_baseSize, m_baseTime));
+    m_bytesSinceCheckpoint = 0;
+    return true;
+}
+
+void SwapJournal::flush() {
+    TRACE_SCOPE("SwapJournal::flush");
+    if (m_pending.isEmpty()) {
+        return;
+    }
+    if (m_needsCheckpoint) {
+        checkpoint();
+        return;
+    }
+    if (!open()) {
+        m_pending.clear();  // Nowhere to write; editing goes on without a journal
+        return;
+    }
+
+    QByteArray records;
+    for (const Edit& edit : m_pending) {
+        records += makeRecord(EditRecord, qint32(edit.position), qint32(edit.charsRemoved), edit.inserted);
+    }
+    m_pending.clear();
+
+    // Replaying a long journal costs more than one copy of the text; past that point a checkpoint takes its place
+    m_bytesSinceCheckpoint += records.size();
+    if (m_bytesSinceCheckpoint > qMax(MinCheckpointBytes, 2 * static_cast<qint64>(m_document->characterCount()))) {
+        checkpoint();
+        return;
+    }
+
+    // Edits that did not make it to disk leave the journal useless; only a checkpoint can replace it
+    if (m_file.write(records) != records.size() || !syncToDisk(m_file)) {
+        close();
+        m_needsCheckpoint = true;
+    }
+}
+
+void SwapJournal::checkpoint() {
+    TRACE_SCOPE("SwapJournal::checkpoint");
+    m_flushTimer.stop();
+    m_pending.clear();  // The text includes them
+    m_needsCheckpoint = true;
+    if (!open()) {
+        return;
+    }
+
+    // QSaveFile replaces the old journal only once the new one is on disk, so a crash meanwhile still finds the old one
+    QString text = m_document->toRawText();
+    text.replace(QChar::ParagraphSeparator, QLatin1Char('\n'));
+    QSaveFile file(m_journalPath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return;
+    }
+    file.write(headerRecord(m_filePath, m_baseSize, m_baseTime));
+    file.write(makeRecord(CheckpointRecord, text));
+    if (!file.commit()) {
+        return;
+    }
+
+    m_file.close();
+    m_file.setFileName(m_journalPath);
+    m_file.open(QIODevice::WriteOnly | QIODevice::Append);
+    m_bytesSinceCheckpoint = 0;
+    m_needsCheckpoint = false;
+}
+
+void SwapJournal::close() {
+    if (m_file.isOpen()) {
+        m_file.close();
+    }
+    if (!m_journalPath.isEmpty()) {
+        QFile::remove(m_journalPath);
+    }
+}
+
+QStringList SwapJournal::orphanedJournals() {
+    QStringList journals;
+    const QDir dir(journalDirectory());
+    for (const QString& name : dir.entryList({QStringLiteral("*.swp")}, QDir::Files, QDir::Time)) {
+        const QString path = dir.filePath(name);
+
+        // Locks of editors that are gone are stale and can be taken
+        QLockFile lock(path + QStringLiteral(".lock"));
+        lock.setStaleLockTime(0);
+        if (lock.tryLock(0)) {
+            journals.append(path);
+        }
+    }
+    return journals;
+}
+
+void SwapJournal::discard(const QString& journalPath) {
+    QFile::remove(journalPath);
+    QFile::remove(journalPath + QStringLiteral(".lock"));
+}
+
+bool SwapJournal::recover(const QString& journalPath, Recovery* recovery, QString* errorString) {
+    TRACE_SCOPE("SwapJournal::recover");
+    auto fail = [errorString](const QString& error) {
+        if (errorString)
+            *errorString = error;
+        return false;
+    };
+
+    QFile file(journalPath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return fail(file.errorString());
+    }
+    const QByteArray data = file.readAll();
+
+    QString filePath;
+    qint64 baseSize = 0;
+    qint64 baseTime = -1;
+    QString text;
+    bool haveHeader = false;
+    bool haveText = false;
+
+    // The edits apply to the file as it was when they were made, which is only usable if it is unchanged
+    auto loadBase = [&]() {
+        if (baseTime < 0) {
+            return true;
+        }
+        const QFileInfo info(filePath);
+        if (info.size() != baseSize || info.lastModified().toMSecsSinceEpoch() != baseTime) {
+            return false;
+        }
+        QFile base(filePath);
+        if (!base.open(QIODevice::ReadOnly)) {
+            return false;
+        }
+        const QByteArray bytes = base.readAll();
+        QStringDecoder decoder(QStringConverter::encodingForData(bytes).value_or(QStringConverter::Utf8));
+        text = decoder.decode(bytes);
+        text.replace(QLatin1String("\r\n"), QLatin1String("\n"));  // As FileLoader put it into the document
+        return true;
+    };
+
+    QDataStream framed(data);
+    while (!framed.atEnd()) {
+        quint32 size = 0;
+        quint16 checksum = 0;
+        framed >> size >> checksum;
+        if (framed.status() != QDataStream::Ok || size > data.size() - framed.device()->pos()) {
+            break;
+        }
+        QByteArray payload(size, Qt::Uninitialized);
+        framed.readRawData(payload.data(), static_cast<int>(size));
+        if (qChecksum(payload) != checksum) {
+            break;
+        }
+
+        QDataStream in(payload);
+        in.setVersion(QDataStream::Qt_6_0);
+        quint8 type = 0;
+        in >> type;
+        if (type == HeaderRecord) {
+            quint32 version = 0;
+            in >> version;
+            if (version != FormatVersion) {
+                return fail(QObject::tr("Unknown journal format %1").arg(version));
+            }
+            in >> filePath >> baseSize >> baseTime;
+            haveHeader = true;
+        }
+        else if (!haveHeader) {
+            break;
+        }
+        else if (type == CheckpointRecord) {
+            in >> text;
+            haveText = true;
+        }
+        else if (type == EditRecord) {
+            qint32 position = 0;
+            qint32 charsRemoved = 0;
+            QString inserted;
+            in >> position >> charsRemoved >> inserted;
+            if (!haveText) {
+                if (!loadBase()) {
+                    return fail(QObject::tr("%1 was changed after the edits were recorded").arg(filePath));
+                }
+                haveText = true;
+            }
+            const int at = qBound(0, static_cast<int>(position), static_cast<int>(text.size()));
+            text.replace(at, qBound(0, static_cast<int>(charsRemoved), static_cast<int>(text.size()) - at), inserted);
+        }
+    }
+
+    if (!haveText) {
+        return fail(QObject::tr("The journal holds no edits"));
+    }
+    recovery->journalPath = journalPath;
+    recovery->filePath = filePath;
+    recovery->text = text;
+    return true;
+}
@@ -0,0 +1,86 @@
+#ifndef SWAPJOURNAL_H
+#define SWAPJOURNAL_H
+
+#include <QDateTime>
+#include <QFile>
+#include <QLockFile>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QTimer>
+#include <QVector>
+#include <memory>
+
+class QTextDocument;
+
+/**
+ * @brief The SwapJournal class
+ *        Keeps the unsaved edits of one document on disk, so they survive a crash.
+ *        Edits are recorded as position, removed length and inserted text, relative
+ *        to the file the document was loaded from, and appended to the journal in
+ *        batches. Only once the edits written outweigh the document is the whole
+ *        text checkpointed into a fresh journal, so the cost of journaling follows
+ *        the amount of editing, not the size of the document. The journal exists
+ *        only while the document has unsaved edits, and a lock file tells the
+ *        journals of running editors from those a crash left behind.
+ */
+class SwapJournal : public QObject {
+    Q_OBJECT
+
+   public:
+    explicit SwapJournal(QTextDocument* document, QObject* parent = nullptr);
+    ~SwapJournal() override;  // Removes the journal; only a crash leaves it behind
+
+    // File the document belongs to, recorded in the journal for recovery; empty for untitled documents
+    void setFilePath(const QString& path) { m_filePath = path; }
+
+    // The document matches its file again, whose size and modification time are given; drops the journal.
+    // An invalid time means the document started out empty rather than from a file.
+    void reset(qint64 baseSize, const QDateTime& baseTime);
+
+    // Records that charsRemoved characters at position were replaced with inserted
+    void record(int position, int charsRemoved, const QString& inserted);
+
+    // Writes the whole document into a fresh journal right away
+    void checkpoint();
+
+    // A journal left behind by a crash, with the text it restores
+    struct Recovery {
+        QString journalPath;
+        QString filePath;  // The document's file, empty if it was untitled
+        QString text;
+    };
+
+    static QString journalDirectory();      // Where journals are kept
+    static QStringList orphanedJournals();  // Journals whose editor is no longer running
+    static bool recover(const QString& journalPath, Recovery* recovery, QString* errorString = nullptr);
+    static void discard(const QString& journalPath);  // Removes a journal and its lock file
+
+    static constexpr int FlushDelayMs = 1000;                   // Edits are collected this long before they are written
+    static constexpr qint64 MinCheckpointBytes = 1024 * 1024;  // Edits written before a checkpoint is worth it
+
+   private:
+    struct Edit {
+        int position = 0;
+        int charsRemoved = 0;
+        QString inserted;
+    };
+
+    bool open();   // Creates the journal and writes its header, on the first flush after a reset
+    void flush();  // Appends the collected edits, or checkpoints when they have outgrown the document
+    void close();  // Removes the journal
+
+    QTextDocument* m_document;
+    QString m_filePath;
+    QString m_journalPath;  // Unique per document; empty until the journal is first written
+    QFile m_file;           // The journal, kept open for appending
+    std::unique_ptr<QLockFile> m_lock;
+    qint64 m_baseSize = 0;
+    QDateTime m_baseTime;
+    qint64 m_bytesSinceCheckpoint = 0;  // Edit bytes written since the journal last held the whole text
+    bool m_needsCheckpoint = false;     // A failed write lost edits, so only the whole text can bring the journal back
+    QVector<Edit> m_pending;            // Edits not written yet
+    QTimer m_flushTimer;
+};
+
+#endif  // SWAPJOURNAL_H
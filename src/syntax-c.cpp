@@ -1,183 +1,402 @@
 #include "syntax-c.h"
+#include "wordtable.h"
+#include "trace.h"
 #include <QColor>
+#include <QString>
 #include <QTextCharFormat>
-#include <QRegularExpression>
-#include <QVector>
 #include <QTextDocument>
+#include <iterator>
 
-CxxSyntaxHighlighter::CxxSyntaxHighlighter(QTextDocument* parent) : QSyntaxHighlighter(parent) {
-    initializeKeywords();
-    initializeTypes();
-    initializePreprocessorDirectives();
-    initializeComments();
-    initializeStrings();
-    initializeNumericLiterals();
-    initializeOperators();
-}
-
-void CxxSyntaxHighlighter::initializeKeywords() {
-    QStringList keywordPatterns = {"\\bbreak\\b",    "\\bcase\\b",     "\\bcontinue\\b", "\\bdefault\\b", "\\bdo\\b",       "\\belse\\b",      "\\bfor\\b",       "\\bgoto\\b",        "\\bif\\b",
-                                   "\\breturn\\b",   "\\bswitch\\b",   "\\bwhile\\b",    "\\basm\\b",     "\\bdecltype\\b", "\\bdelete\\b",    "\\bfriend\\b",    "\\bnamespace\\b",   "\\bnew\\b",
-                                   "\\boperator\\b", "\\bthis\\b",     "\\bthrow\\b",    "\\btry\\b",     "\\bcatch\\b",    "\\busing\\b",     "\\bco_await\\b",  "\\bco_return\\b",   "\\bco_yield\\b",
-                                   "\\bconcept\\b",  "\\brequires\\b", "\\bmodule\\b",   "\\bimport\\b",  "\\bexport\\b",   "\\bconsteval\\b", "\\bconstinit\\b", "\\boperator\"\"\\b"};
+namespace {
 
-    QTextCharFormat keywordFormat;
-    keywordFormat.setForeground(QColor("#C586C0"));
-    keywordFormat.setFontWeight(QFont::Bold);
+bool isIdentifierStart(QChar c) {
+    const char16_t u = c.unicode();
+    if (u < 128)
+        return (u >= 'a' && u <= 'z') || (u >= 'A' && u <= 'Z') || u == '_';
+    return c.isLetter();
+}
 
-    for (const QString& pattern : keywordPatterns) {
-        HighlightingRule rule;
-        rule.pattern = QRegularExpression(pattern);
-        rule.format = keywordFormat;
-        highlightingRules.append(rule);
-    }
-}
-
-void CxxSyntaxHighlighter::initializeTypes() {
-    QStringList typePatterns = {"\\bbool\\b",      "\\bchar\\b",      "\\bwchar_t\\b",   "\\bshort\\b",        "\\blong\\b",     "\\bsigned\\b",    "\\bunsigned\\b",  "\\bfloat\\b",
-                                "\\bdouble\\b",    "\\bvoid\\b",      "\\bint8_t\\b",    "\\buint8_t\\b",      "\\bint16_t\\b",  "\\buint16_t\\b",  "\\bint32_t\\b",   "\\buint32_t\\b",
-                                "\\bint64_t\\b",   "\\buint64_t\\b",  "\\bsize_t\\b",    "\\bptrdiff_t\\b",    "\\bintptr_t\\b", "\\buintptr_t\\b", "\\bchar16_t\\b",  "\\bchar32_t\\b",
-                                "\\bchar8_t\\b",   "\\bstruct\\b",    "\\bunion\\b",     "\\benum\\b",         "\\bclass\\b",    "\\btypename\\b",  "\\btemplate\\b",  "\\bauto\\b",
-                                "\\bconstexpr\\b", "\\bconstinit\\b", "\\bconsteval\\b", "\\bthread_local\\b", "\\bmutable\\b",  "\\binline\\b",    "\\bvirtual\\b",   "\\bexplicit\\b",
-                                "\\bstatic\\b",    "\\bregister\\b",  "\\bextern\\b",    "\\bvolatile\\b",     "\\brestrict\\b", "\\btypename\\b",  "\\bNULL\\b",      "\\bnullptr\\b",
-                                "\\bnullptr_t\\b", "\\bTRUE\\b",      "\\bFALSE\\b",     "\\btrue\\b",         "\\bfalse\\b",    "\\bstd::\\w+\\b", "\\[\\[\\w+\\]\\]"};
+bool isIdentifierChar(QChar c) {
+    const char16_t u = c.unicode();
+    if (u < 128)
+        return (u >= 'a' && u <= 'z') || (u >= 'A' && u <= 'Z') || (u >= '0' && u <= '9') || u == '_';
+    return c.isLetterOrNumber();
+}
 
-    QTextCharFormat typeFormat;
-    typeFormat.setForeground(QColor("#4FC1FF"));
+bool isDigit(QChar c) {
+    return c.unicode() >= '0' && c.unicode() <= '9';
+}
 
-    for (const QString& pattern : typePatterns) {
-        HighlightingRule rule;
-        rule.pattern = QRegularExpression(pattern);
-        rule.format = typeFormat;
-        highlightingRules.append(rule);
+bool isHexDigit(QChar c) {
+    const char16_t u = c.unicode();
+    return isDigit(c) || (u >= 'a' && u <= 'f') || (u >= 'A' && u <= 'F');
+}
+
+bool isOperatorChar(QChar c) {
+    switch (c.unicode()) {
+        case '+':
+        case '-':
+        case '*':
+        case '/':
+        case '%':
+        case '&':
+        case '|':
+        case '^':
+        case '!':
+        case '=':
+        case '<':
+        case '>':
+        case '~':
+            return true;
+        default:
+            return false;
     }
 }
 
-void CxxSyntaxHighlighter::initializePreprocessorDirectives() {
-    HighlightingRule rule;
-    QTextCharFormat preprocessorFormat;
-    preprocessorFormat.setForeground(QColor("#569CD6"));
-    preprocessorFormat.setFontWeight(QFont::Bold);
+constexpr TokenKind Keyword = TokenKind::Keyword;
+constexpr TokenKind Type = TokenKind::Type;
+constexpr TokenKind Todo = TokenKind::Todo;
+constexpr TokenKind Directive = TokenKind::Preprocessor;
+
+// Every identifier the lexer colors; the table is hashed at compile time
+constexpr WordEntry cxxWordList[] = {
+    {"break", Keyword}, {"case", Keyword}, {"continue", Keyword}, {"default", Keyword}, {"do", Keyword}, {"else", Keyword},
+    {"for", Keyword}, {"goto", Keyword}, {"if", Keyword}, {"return", Keyword}, {"switch", Keyword}, {"while", Keyword},
+    {"asm", Keyword}, {"decltype", Keyword}, {"delete", Keyword}, {"friend", Keyword}, {"namespace", Keyword}, {"new", Keyword},
+    {"operator", Keyword}, {"this", Keyword}, {"throw", Keyword}, {"try", Keyword}, {"catch", Keyword}, {"using", Keyword},
+    {"co_await", Keyword}, {"co_return", Keyword}, {"co_yield", Keyword}, {"concept", Keyword}, {"requires", Keyword}, {"module", Keyword},
+    {"import", Keyword}, {"export", Keyword},
+    {"bool", Type}, {"char", Type}, {"wchar_t", Type}, {"short", Type}, {"long", Type}, {"signed", Type},
+    {"unsigned", Type}, {"float", Type}, {"double", Type}, {"void", Type}, {"int8_t", Type}, {"uint8_t", Type},
+    {"int16_t", Type}, {"uint16_t", Type}, {"int32_t", Type}, {"uint32_t", Type}, {"int64_t", Type}, {"uint64_t", Type},
+    {"size_t", Type}, {"ptrdiff_t", Type}, {"intptr_t", Type}, {"uintptr_t", Type}, {"char16_t", Type}, {"char32_t", Type},
+    {"char8_t", Type}, {"struct", Type}, {"union", Type}, {"enum", Type}, {"class", Type}, {"typename", Type},
+    {"template", Type}, {"auto", Type}, {"constexpr", Type}, {"constinit", Type}, {"consteval", Type}, {"thread_local", Type},
+    {"mutable", Type}, {"inline", Type}, {"virtual", Type}, {"explicit", Type}, {"static", Type}, {"register", Type},
+    {"extern", Type}, {"volatile", Type}, {"restrict", Type}, {"NULL", Type}, {"nullptr", Type}, {"nullptr_t", Type},
+    {"TRUE", Type}, {"FALSE", Type}, {"true", Type}, {"false", Type},
+    {"TODO", Todo}, {"FIXME", Todo},
+};
+
+constexpr WordEntry cxxDirectiveList[] = {
+    {"if", Directive}, {"ifdef", Directive}, {"ifndef", Directive}, {"endif", Directive}, {"include", Directive}, {"define", Directive},
+    {"undef", Directive}, {"elif", Directive}, {"else", Directive}, {"pragma", Directive}, {"error", Directive}, {"warning", Directive},
+};
+
+constexpr WordTable<std::size(cxxWordList), 1024> cxxWords(cxxWordList);
+constexpr WordTable<std::size(cxxDirectiveList), 128> cxxDirectives(cxxDirectiveList);
 
-    rule.pattern = QRegularExpression(
-        "^[ \t]*(#|%:)\\s*(?:if\\b|ifdef\\b|ifndef\\b|endif\\b|include\\b|"
-        "define\\b|undef\\b|elif\\b|else\\b|pragma\\b|error\\b|warning\\b)");
-    rule.format = preprocessorFormat;
-    highlightingRules.append(rule);
+bool isTodoMarker(QStringView word) {
+    return word == QLatin1String("TODO") || word == QLatin1String("FIXME");
 }
 
-void CxxSyntaxHighlighter::initializeComments() {
-    {
-        HighlightingRule rule;
-        QTextCharFormat singleLineCommentFormat;
-        singleLineCommentFormat.setForeground(QColor("#6A9955"));
-        rule.pattern = QRegularExpression("//[^\n]*");
-        rule.format = singleLineCommentFormat;
-        highlightingRules.append(rule);
+void addSpan(QVector<HighlightSpan>& spans, int start, int length, TokenKind kind) {
+    if (length > 0) {
+        spans.append({start, length, kind});
     }
+}
 
-    {
-        HighlightingRule rule;
-        QTextCharFormat todoFormat;
-        todoFormat.setForeground(QColor("#FF9C00"));
-        todoFormat.setFontWeight(QFont::Bold);
-        rule.pattern = QRegularExpression("\\b(TODO|FIXME)\\b");
-        rule.format = todoFormat;
-        highlightingRules.append(rule);
+// Adds a comment over [from, to), with TODO/FIXME markers split out as their own spans
+void addCommentSpans(QStringView text, int from, int to, QVector<HighlightSpan>& spans) {
+    int runStart = from;
+    int i = from;
+    while (i < to) {
+        if (isIdentifierStart(text[i]) && (i == 0 || !isIdentifierChar(text[i - 1]))) {
+            int end = i + 1;
+            while (end < to && isIdentifierChar(text[end])) {
+                ++end;
+            }
+            if (isTodoMarker(text.sliced(i, end - i))) {
+                addSpan(spans, runStart, i - runStart, TokenKind::Comment);
+                addSpan(spans, i, end - i, TokenKind::Todo);
+                runStart = end;
+            }
+            i = end;
+        }
+        else {
+            ++i;
+        }
     }
-
-    multiLineCommentFormat.setForeground(QColor("#6A9955"));
+    addSpan(spans, runStart, to - runStart, TokenKind::Comment);
 }
 
-void CxxSyntaxHighlighter::initializeStrings() {
-    {
-        HighlightingRule rule;
-        QTextCharFormat stringFormat;
-        stringFormat.setForeground(QColor("#CE9178"));
-        rule.pattern = QRegularExpression("\"([^\"\\\\]|\\\\.)*\"");
-        rule.format = stringFormat;
-        highlightingRules.append(rule);
+// Quoted string or character literal; start is the first character of any encoding prefix
+int lexQuoted(QStringView text, int start, int quote, QVector<HighlightSpan>& spans) {
+    const int length = static_cast<int>(text.size());
+    const QChar delimiter = text[quote];
+    int i = quote + 1;
+    while (i < length) {
+        if (text[i] == QLatin1Char('\\')) {
+            i += 2;
+            continue;
+        }
+        if (text[i++] == delimiter) {
+            break;
+        }
     }
+    i = qMin(i, length);
+    addSpan(spans, start, i - start, TokenKind::String);
+    return i;
+}
 
-    {
-        HighlightingRule rule;
-        QTextCharFormat charFormat;
-        charFormat.setForeground(QColor("#CE9178"));
-        rule.pattern = QRegularExpression("'([^'\\\\]|\\\\.)*'");
-        rule.format = charFormat;
-        highlightingRules.append(rule);
+// R"delim( ... )delim" on a single line
+int lexRawString(QStringView text, int start, int quote, QVector<HighlightSpan>& spans) {
+    const int length = static_cast<int>(text.size());
+    int open = quote + 1;
+    while (open < length && open - quote <= 17 && text[open] != QLatin1Char('(')) {
+        ++open;
+    }
+    if (open >= length || text[open] != QLatin1Char('(')) {
+        return lexQuoted(text, start, quote, spans);
     }
 
-    {
-        HighlightingRule rule;
-        QTextCharFormat rawStringFormat;
-        rawStringFormat.setForeground(QColor("#CE9178"));
-        rule.pattern = QRegularExpression(R"(\b(?:[uU]|u8|L)?R"([^()\\"]*)\([^)]*\)\1"\b)");
-        rule.format = rawStringFormat;
-        highlightingRules.append(rule);
+    const QStringView delimiter = text.sliced(quote + 1, open - quote - 1);
+    int from = open + 1;
+    while (true) {
+        const int close = static_cast<int>(text.indexOf(QLatin1Char(')'), from));
+        if (close < 0) {
+            addSpan(spans, start, length - start, TokenKind::String);
+            return length;
+        }
+        const int quoteAfter = close + 1 + static_cast<int>(delimiter.size());
+        if (quoteAfter < length && text[quoteAfter] == QLatin1Char('"') && text.sliced(close + 1, delimiter.size()) == delimiter) {
+            addSpan(spans, start, quoteAfter + 1 - start, TokenKind::String);
+            return quoteAfter + 1;
+        }
+        from = close + 1;
     }
 }
 
-void CxxSyntaxHighlighter::initializeNumericLiterals() {
-    HighlightingRule rule;
-    QTextCharFormat numberFormat;
-    numberFormat.setForeground(QColor("#4EC9B0"));
+int lexNumber(QStringView text, int i, QVector<HighlightSpan>& spans) {
+    const int length = static_cast<int>(text.size());
+    const int start = i;
+    const QChar next = i + 1 < length ? text[i + 1] : QChar();
 
-    QString numericPattern = R"REGEX(
-        \b(
-          0[xX][0-9A-Fa-f']+     |
-          0[bB][01']+           |
-          \d[\d']*(\.[\d']+)?([eE][+-]?\d+)?[fFlL]?
-        )\b
-    )REGEX";
+    if (text[i] == QLatin1Char('0') && (next == QLatin1Char('x') || next == QLatin1Char('X'))) {
+        i += 2;
+        while (i < length && (isHexDigit(text[i]) || text[i] == QLatin1Char('\''))) {
+            ++i;
+        }
+    }
+    else if (text[i] == QLatin1Char('0') && (next == QLatin1Char('b') || next == QLatin1Char('B'))) {
+        i += 2;
+        while (i < length && (text[i] == QLatin1Char('0') || text[i] == QLatin1Char('1') || text[i] == QLatin1Char('\''))) {
+            ++i;
+        }
+    }
+    else {
+        while (i < length && (isDigit(text[i]) || text[i] == QLatin1Char('\''))) {
+            ++i;
+        }
+        if (i < length && text[i] == QLatin1Char('.')) {
+            ++i;
+            while (i < length && (isDigit(text[i]) || text[i] == QLatin1Char('\''))) {
+                ++i;
+            }
+        }
+        if (i < length && (text[i] == QLatin1Char('e') || text[i] == QLatin1Char('E'))) {
+            int j = i + 1;
+            if (j < length && (text[j] == QLatin1Char('+') || text[j] == QLatin1Char('-'))) {
+                ++j;
+            }
+            if (j < length && isDigit(text[j])) {
+                i = j;
+                while (i < length && isDigit(text[i])) {
+                    ++i;
+                }
+            }
+        }
+    }
 
-    rule.pattern = QRegularExpression(numericPattern, QRegularExpression::ExtendedPatternSyntaxOption);
-    rule.format = numberFormat;
-    highlightingRules.append(rule);
+    // Suffixes such as u, ul, f or a user-defined literal
+    while (i < length && isIdentifierChar(text[i])) {
+        ++i;
+    }
+    addSpan(spans, start, i - start, TokenKind::Number);
+    return i;
 }
 
-void CxxSyntaxHighlighter::initializeOperators() {
-    HighlightingRule rule;
-    QTextCharFormat operatorFormat;
-    operatorFormat.setForeground(QColor("#D7BA7D"));
+int lexWord(QStringView text, int i, QVector<HighlightSpan>& spans) {
+    const int length = static_cast<int>(text.size());
+    const int start = i;
+    while (i < length && isIdentifierChar(text[i])) {
+        ++i;
+    }
+    const QStringView word = text.sliced(start, i - start);
 
-    rule.pattern = QRegularExpression("[+\\-*/%&|^!=<>]=?|\\|\\||&&|<<=?|>>=?|\\+\\+|--|\\?\\:|~|->|=>");
-    rule.format = operatorFormat;
-    highlightingRules.append(rule);
+    // Encoding prefixes glue onto the literal that follows them
+    if (i < length && (text[i] == QLatin1Char('"') || text[i] == QLatin1Char('\''))) {
+        if (text[i] == QLatin1Char('"') &&
+            (word == QLatin1String("R") || word == QLatin1String("uR") || word == QLatin1String("UR") || word == QLatin1String("LR") || word == QLatin1String("u8R"))) {
+            return lexRawString(text, start, i, spans);
+        }
+        if (word == QLatin1String("u") || word == QLatin1String("U") || word == QLatin1String("L") || word == QLatin1String("u8")) {
+            return lexQuoted(text, start, i, spans);
+        }
+    }
+
+    if (word == QLatin1String("std") && i + 2 < length && text[i] == QLatin1Char(':') && text[i + 1] == QLatin1Char(':') && isIdentifierStart(text[i + 2])) {
+        int end = i + 2;
+        while (end < length && isIdentifierChar(text[end])) {
+            ++end;
+        }
+        addSpan(spans, start, end - start, TokenKind::Type);
+        return end;
+    }
+
+    TokenKind kind;
+    if (cxxWords.classify(word, &kind)) {
+        addSpan(spans, start, i - start, kind);
+    }
+    return i;
 }
 
-void CxxSyntaxHighlighter::highlightBlock(const QString& text) {
-    setCurrentBlockState(0);
+}  // namespace
+
+CxxSyntaxHighlighter::CxxSyntaxHighlighter(QTextDocument* parent) : IncrementalHighlighter(parent), m_rules(rules()) {}
 
-    int startIndex = (previousBlockState() == 1) ? 0 : text.indexOf("/*");
-    while (startIndex >= 0) {
-        int endIndex = text.indexOf("*/", startIndex);
-        int commentLength = 0;
+const HighlightRules& CxxSyntaxHighlighter::rules() {
+    static const HighlightRules shared = [] {
+        HighlightRules cxx;
+        cxx.tokenize = &CxxSyntaxHighlighter::tokenize;
 
-        if (endIndex == -1) {
-            setCurrentBlockState(1);
-            commentLength = text.length() - startIndex;
+        auto format = [&cxx](TokenKind kind) -> QTextCharFormat& { return cxx.formats[static_cast<int>(kind)]; };
+        format(TokenKind::Keyword).setForeground(QColor("#C586C0"));
+        format(TokenKind::Keyword).setFontWeight(QFont::Bold);
+        format(TokenKind::Type).setForeground(QColor("#4FC1FF"));
+        format(TokenKind::Preprocessor).setForeground(QColor("#569CD6"));
+        format(TokenKind::Preprocessor).setFontWeight(QFont::Bold);
+        format(TokenKind::Comment).setForeground(QColor("#6A9955"));
+        format(TokenKind::Todo).setForeground(QColor("#FF9C00"));
+        format(TokenKind::Todo).setFontWeight(QFont::Bold);
+        format(TokenKind::String).setForeground(QColor("#CE9178"));
+        format(TokenKind::Number).setForeground(QColor("#4EC9B0"));
+        format(TokenKind::Operator).setForeground(QColor("#D7BA7D"));
+        return cxx;
+    }();
+    return shared;
+}
+
+int CxxSyntaxHighlighter::tokenize(QStringView text, int previousState, QVector<HighlightSpan>& spans) {
+    spans.clear();
+    const int length = static_cast<int>(text.size());
+    int i = 0;
+
+    if (previousState == InBlockComment) {
+        const int end = static_cast<int>(text.indexOf(QLatin1String("*/")));
+        if (end < 0) {
+            addCommentSpans(text, 0, length, spans);
+            return InBlockComment;
         }
-        else {
-            commentLength = endIndex - startIndex + 2;
+        addCommentSpans(text, 0, end + 2, spans);
+        i = end + 2;
+    }
+    else {
+        // A directive keeps the whitespace in front of it inside its span
+        int p = 0;
+        while (p < length && (text[p] == QLatin1Char(' ') || text[p] == QLatin1Char('\t'))) {
+            ++p;
+        }
+        int hash = 0;
+        if (p < length && text[p] == QLatin1Char('#')) {
+            hash = 1;
+        }
+        else if (p + 1 < length && text[p] == QLatin1Char('%') && text[p + 1] == QLatin1Char(':')) {
+            hash = 2;
+        }
+        if (hash) {
+            int word = p + hash;
+            while (word < length && text[word].isSpace()) {
+                ++word;
+            }
+            int end = word;
+            while (end < length && isIdentifierChar(text[end])) {
+                ++end;
+            }
+            TokenKind kind;
+            if (end > word && cxxDirectives.classify(text.sliced(word, end - word), &kind)) {
+                addSpan(spans, 0, end, TokenKind::Preprocessor);
+                i = end;
+            }
         }
+    }
 
-        setFormat(startIndex, commentLength, multiLineCommentFormat);
+    while (i < length) {
+        const QChar c = text[i];
+        const QChar next = i + 1 < length ? text[i + 1] : QChar();
 
-        if (endIndex == -1) {
-            break;
+        if (c == QLatin1Char('/') && next == QLatin1Char('/')) {
+            addCommentSpans(text, i, length, spans);
+            return Normal;
+        }
+        if (c == QLatin1Char('/') && next == QLatin1Char('*')) {
+            const int end = static_cast<int>(text.indexOf(QLatin1String("*/"), i + 2));
+            if (end < 0) {
+                addCommentSpans(text, i, length, spans);
+                return InBlockComment;
+            }
+            addCommentSpans(text, i, end + 2, spans);
+            i = end + 2;
+        }
+        else if (c == QLatin1Char('"') || c == QLatin1Char('\'')) {
+            i = lexQuoted(text, i, i, spans);
+        }
+        else if (isDigit(c) || (c == QLatin1Char('.') && isDigit(next))) {
+            i = lexNumber(text, i, spans);
+        }
+        else if (isIdentifierStart(c)) {
+            i = lexWord(text, i, spans);
+        }
+        else if (c == QLatin1Char('[') && next == QLatin1Char('[')) {
+            // [[attribute]] is shown like a type
+            int end = i + 2;
+            while (end < length && isIdentifierChar(text[end])) {
+                ++end;
+            }
+            if (end > i + 2 && end + 1 < length && text[end] == QLatin1Char(']') && text[end + 1] == QLatin1Char(']')) {
+                addSpan(spans, i, end + 2 - i, TokenKind::Type);
+                i = end + 2;
+            }
+            else {
+                i += 2;
+            }
+        }
+        else if (isOperatorChar(c)) {
+            int end = i + 1;
+            while (end < length && isOperatorChar(text[end])) {
+                if (text[end] == QLatin1Char('/') && end + 1 < length && (text[end + 1] == QLatin1Char('/') || text[end + 1] == QLatin1Char('*'))) {
+                    break;
+                }
+                ++end;
+            }
+            addSpan(spans, i, end - i, TokenKind::Operator);
+            i = end;
+        }
+        else if (c == QLatin1Char('?') && next == QLatin1Char(':')) {
+            addSpan(spans, i, 2, TokenKind::Operator);
+            i += 2;
         }
         else {
-            startIndex = text.indexOf("/*", endIndex + 2);
+            ++i;
         }
     }
+    return Normal;
+}
 
-    for (const auto& rule : highlightingRules) {
-        auto matchIt = rule.pattern.globalMatch(text);
-        while (matchIt.hasNext()) {
-            auto match = matchIt.next();
-            setFormat(match.capturedStart(), match.capturedLength(), rule.format);
-        }
+void CxxSyntaxHighlighter::highlightBlock(const QString& text) {
+    TRACE_SCOPE("CxxSyntaxHighlighter::highlightBlock");
+    if (deferCurrentBlock()) {
+        return;
+    }
+
+    int state = 0;
+    if (!takePrecomputed(spans, &state)) {
+        state = m_rules.tokenize(text, previousBlockState(), spans);
+    }
+    setCurrentBlockState(state);
+
+    for (const HighlightSpan& span : spans) {
+        setFormat(span.start, span.length, m_rules.format(span.kind));
     }
 }
 
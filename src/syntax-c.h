@@ -1,18 +1,21 @@
 #ifndef SYNTAX_C_H
 #define SYNTAX_C_H
 
-#include <QSyntaxHighlighter>
-#include <QRegularExpression>
+#include <QStringView>
 #include <QVector>
 #include <QTextCharFormat>
 #include <QTextDocument>
 
+#include "incrementalhighlighter.h"
+#include "language_support.h"
+
 /**
  * @brief The CxxSyntaxHighlighter class
  *        A custom syntax highlighter for C and C++ code. It supports highlighting
  *        various code elements like keywords, types, operators, comments, etc.
+ *        Instances are cheap: the lexer tables and formats live in the shared rules().
  */
-class CxxSyntaxHighlighter : public QSyntaxHighlighter {
+class CxxSyntaxHighlighter : public IncrementalHighlighter {
     Q_OBJECT
 
    public:
@@ -22,6 +25,28 @@ class CxxSyntaxHighlighter : public QSyntaxHighlighter {
      */
     explicit CxxSyntaxHighlighter(QTextDocument* parent = nullptr);
 
+    /// Block states carried from one line to the next.
+    enum BlockState { Normal = 0, InBlockComment = 1 };
+
+    /**
+     * @brief Splits one line into classified spans in a single left-to-right pass.
+     *        Spans never overlap, so every character is formatted at most once.
+     *        The function has no side effects and may be called from any thread.
+     * @param text The line to tokenize.
+     * @param previousState The state the previous line ended in (-1 counts as Normal).
+     * @param spans Receives the spans of the line; it is cleared first.
+     * @return The state this line ends in.
+     */
+    static int tokenize(QStringView text, int previousState, QVector<HighlightSpan>& spans);
+
+    /**
+     * @brief The C/C++ rules shared by every CxxSyntaxHighlighter.
+     *        Built on first use; thread-safe and never modified afterwards.
+     */
+    static const HighlightRules& rules();
+
+    HighlightEngine::Tokenizer tokenizer() const override { return m_rules.tokenize; }
+
    protected:
     /**
      * @brief Overrides the highlightBlock method to apply syntax highlighting to the given block of text.
@@ -30,25 +55,8 @@ class CxxSyntaxHighlighter : public QSyntaxHighlighter {
     void highlightBlock(const QString& text) override;
 
    private:
-    // Struct representing a highlighting rule with a regex pattern and corresponding format.
-    struct HighlightingRule {
-        QRegularExpression pattern;  ///< Regex pattern for matching tokens.
-        QTextCharFormat format;      ///< Formatting to apply when the pattern is matched.
-    };
-
-    // Private methods to initialize different categories of syntax elements.
-    void initializeKeywords();                ///< Initializes keyword patterns and formatting.
-    void initializeTypes();                   ///< Initializes type patterns and formatting.
-    void initializePreprocessorDirectives();  ///< Initializes preprocessor directive patterns and formatting.
-    void initializeComments();                ///< Initializes comment patterns (single-line, multi-line, TODO/FIXME).
-    void initializeStrings();                 ///< Initializes string literal patterns and formatting.
-    void initializeNumericLiterals();         ///< Initializes numeric literal patterns and formatting.
-    void initializeOperators();               ///< Initializes operator patterns and formatting.
-    void initializeTodoFixme();               ///< Initializes TODO/FIXME patterns and formatting for inline comments.
-
-    QVector<HighlightingRule> highlightingRules;  ///< Collection of all highlighting rules.
-
-    QTextCharFormat multiLineCommentFormat;  ///< Format for multi-line comments (/* ... */).
+    const HighlightRules& m_rules;  ///< Shared lexer and formats of the language.
+    QVector<HighlightSpan> spans;   ///< Reused span buffer for highlightBlock.
 };
 
 /**
@@ -0,0 +1,449 @@
+#include "textsearch.h"
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QtAlgorithms>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+// Compares the characters between the first and the last, which the scan already matched
+bool middleEquals(const char16_t* candidate, const char16_t* needle, qsizetype length) {
+    return length <= 2 || std::memcmp(candidate + 1, needle + 1, static_cast<size_t>(length - 2) * sizeof(char16_t)) == 0;
+}
+
+// One piece of a parsed replacement template: literal text, or a captured group by number or name
+struct TemplatePart {
+    QString literal;
+    int group = -1;
+    QString name;
+};
+
+QVector<TemplatePart> parseTemplate(QStringView replacement) {
+    QVector<TemplatePart> parts;
+    QString literal;
+    auto flush = [&]() {
+        if (!literal.isEmpty()) {
+            parts.append({literal, -1, QString()});
+            literal.clear();
+        }
+    };
+
+    for (qsizetype i = 0; i < replacement.size(); ++i) {
+        const QChar c = replacement[i];
+        if (c != QLatin1Char('\\') || i + 1 == replacement.size()) {
+            literal += c;
+            continue;
+        }
+
+        const QChar next = replacement[++i];
+        const qsizetype close = next == QLatin1Char('g') && i + 1 < replacement.size() && replacement[i + 1] == QLatin1Char('<') ? replacement.indexOf(QLatin1Char('>'), i + 2) : -1;
+        if (next >= QLatin1Char('0') && next <= QLatin1Char('9')) {
+            flush();
+            parts.append({QString(), next.digitValue(), QString()});
+        }
+        else if (close > 0) {
+            flush();
+            const QStringView name = replacement.sliced(i + 2, close - i - 2);
+            bool isNumber = false;
+            const int group = name.toInt(&isNumber);
+            parts.append({QString(), isNumber ? group : -1, isNumber ? QString() : name.toString()});
+            i = close;
+        }
+        else if (next == QLatin1Char('n')) {
+            literal += QLatin1Char('\n');
+        }
+        else if (next == QLatin1Char('t')) {
+            literal += QLatin1Char('\t');
+        }
+        else {
+            literal += next;
+        }
+    }
+    flush();
+    return parts;
+}
+
+void appendExpanded(QString& out, const QVector<TemplatePart>& parts, const QRegularExpressionMatch& match) {
+    for (const TemplatePart& part : parts) {
+        if (part.group >= 0) {
+            out += match.capturedView(part.group);
+        }
+        else if (!part.name.isEmpty()) {
+            out += match.capturedView(part.name);
+        }
+        else {
+            out += part.literal;
+        }
+    }
+}
+
+uchar foldAscii(uchar c) {
+    return c >= 'A' && c <= 'Z' ? static_cast<uchar>(c | 0x20) : c;
+}
+
+bool bytesEqual(const uchar* candidate, const uchar* needle, qsizetype length, Qt::CaseSensitivity cs) {
+    if (cs == Qt::CaseSensitive) {
+        return std::memcmp(candidate, needle, static_cast<size_t>(length)) == 0;
+    }
+    for (qsizetype i = 0; i < length; ++i) {
+        if (foldAscii(candidate[i]) != foldAscii(needle[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}  // namespace
+
+qsizetype TextSearch::indexOf(QStringView haystack, QStringView needle, qsizetype from) {
+    const qsizetype length = needle.size();
+    if (length == 0 || from < 0 || haystack.size() - from < length) {
+        return -1;
+    }
+
+    const char16_t* h = haystack.utf16();
+    const char16_t* p = needle.utf16();
+    const char16_t first = p[0];
+    const char16_t last = p[length - 1];
+    const qsizetype lastStart = haystack.size() - length;
+    qsizetype i = from;
+
+#if defined(__SSE2__)
+    const __m128i firstChars = _mm_set1_epi16(static_cast<short>(first));
+    const __m128i lastChars = _mm_set1_epi16(static_cast<short>(last));
+    for (; i + 8 <= lastStart + 1; i += 8) {
+        const __m128i heads = _mm_loadu_si128(reinterpret_cast<const __m128i*>(h + i));
+        const __m128i tails = _mm_loadu_si128(reinterpret_cast<const __m128i*>(h + i + length - 1));
+        quint32 mask = static_cast<quint32>(_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi16(heads, firstChars), _mm_cmpeq_epi16(tails, lastChars))));
+        while (mask) {
+            // Every matching 16-bit lane sets two mask bits
+            const int lane = qCountTrailingZeroBits(mask) / 2;
+            if (middleEquals(h + i + lane, p, length)) {
+                return i + lane;
+            }
+            mask &= ~(3u << (lane * 2));
+        }
+    }
+#endif
+
+    for (; i <= lastStart; ++i) {
+        if (h[i] == first && h[i + length - 1] == last && middleEquals(h + i, p, length)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+qsizetype TextSearch::indexOf(QByteArrayView haystack, QByteArrayView needle, Qt::CaseSensitivity cs, qsizetype from) {
+    const qsizetype length = needle.size();
+    if (length == 0 || from < 0 || haystack.size() - from < length) {
+        return -1;
+    }
+
+    const uchar* h = reinterpret_cast<const uchar*>(haystack.data());
+    const uchar* p = reinterpret_cast<const uchar*>(needle.data());
+    const bool fold = cs == Qt::CaseInsensitive;
+    const uchar first = fold ? foldAscii(p[0]) : p[0];
+    const uchar last = fold ? foldAscii(p[length - 1]) : p[length - 1];
+    const qsizetype lastStart = haystack.size() - length;
+    qsizetype i = from;
+
+#if defined(__SSE2__)
+    // Setting bit 5 folds ASCII letters; it also aliases a few other bytes, which the check below rejects
+    const bool firstIsLetter = fold && first >= 'a' && first <= 'z';
+    const bool lastIsLetter = fold && last >= 'a' && last <= 'z';
+    const __m128i firstFold = _mm_set1_epi8(static_cast<char>(firstIsLetter ? 0x20 : 0));
+    const __m128i lastFold = _mm_set1_epi8(static_cast<char>(lastIsLetter ? 0x20 : 0));
+    const __m128i firstBytes = _mm_set1_epi8(static_cast<char>(first));
+    const __m128i lastBytes = _mm_set1_epi8(static_cast<char>(last));
+    for (; i + 16 <= lastStart + 1; i += 16) {
+        const __m128i heads = _mm_or_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(h + i)), firstFold);
+        const __m128i tails = _mm_or_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(h + i + length - 1)), lastFold);
+        quint32 mask = static_cast<quint32>(_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(heads, firstBytes), _mm_cmpeq_epi8(tails, lastBytes))));
+        while (mask) {
+            const int lane = qCountTrailingZeroBits(mask);
+            if (bytesEqual(h + i + lane, p, length, cs)) {
+                return i + lane;
+            }
+            mask &= mask - 1;
+        }
+    }
+#endif
+
+    for (; i <= lastStart; ++i) {
+        if ((fold ? foldAscii(h[i]) : h[i]) == first && bytesEqual(h + i, p, length, cs)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+QVector<int> TextSearch::findAll(QStringView haystack, QStringView needle, int maxMatches, const std::atomic<bool>* cancelled) {
+    constexpr qsizetype Window = 1024 * 1024;
+
+    QVector<int> matches;
+    if (needle.isEmpty()) {
+        return matches;
+    }
+
+    qsizetype from = 0;
+    while (matches.size() < maxMatches && from + needle.size() <= haystack.size()) {
+        if (cancelled && *cancelled) {
+            break;
+        }
+
+        // Windows overlap by the needle length minus one, so no match straddles two of them unseen
+        const qsizetype windowEnd = qMin(haystack.size(), from + Window + needle.size() - 1);
+        const QStringView window = haystack.first(windowEnd);
+        qsizetype found = indexOf(window, needle, from);
+        while (found >= 0 && matches.size() < maxMatches) {
+            matches.append(static_cast<int>(found));
+            found = indexOf(window, needle, found + 1);
+        }
+        from = windowEnd - needle.size() + 1;
+    }
+    return matches;
+}
+
+QVector<int> TextSearch::narrow(QStringView haystack, QStringView needle, const QVector<int>& candidates, const std::atomic<bool>* cancelled) {
+    QVector<int> matches;
+    const qsizetype length = needle.size();
+    for (int i = 0; i < candidates.size(); ++i) {
+        if (cancelled && (i & 0xFFFF) == 0 && *cancelled) {
+            break;
+        }
+        const qsizetype at = candidates[i];
+        if (at + length <= haystack.size() && haystack.sliced(at, length) == needle) {
+            matches.append(candidates[i]);
+        }
+    }
+    return matches;
+}
+
+TextSearch::Replacement TextSearch::replaceAll(QStringView text, QStringView haystack, QStringView needle, QStringView replacement) {
+    Replacement result;
+    qsizetype found = indexOf(haystack, needle, 0);
+    if (found < 0) {
+        return result;
+    }
+
+    result.start = found;
+    qsizetype from = found;
+    while (found >= 0) {
+        result.text += text.sliced(from, found - from);
+        result.text += replacement;
+        ++result.count;
+        from = found + needle.size();
+        found = indexOf(haystack, needle, from);
+    }
+    result.end = from;
+    return result;
+}
+
+QRegularExpression TextSearch::regex(const QString& pattern, Qt::CaseSensitivity cs) {
+    constexpr int MaxCached = 32;
+    static QMutex mutex;
+    static QHash<QString, QRegularExpression> cache;
+
+    QRegularExpression::PatternOptions options = QRegularExpression::MultilineOption | QRegularExpression::UseUnicodePropertiesOption;
+    if (cs == Qt::CaseInsensitive) {
+        options |= QRegularExpression::CaseInsensitiveOption;
+    }
+    const QString key = QString::number(options.toInt()) + QLatin1Char(':') + pattern;
+
+    QMutexLocker locker(&mutex);
+    auto it = cache.constFind(key);
+    if (it != cache.constEnd()) {
+        return it.value();
+    }
+
+    // Compiled and JIT-optimized here, once, rather than on the first match of every copy
+    QRegularExpression re(pattern, options);
+    re.optimize();
+    if (cache.size() >= MaxCached) {
+        cache.clear();
+    }
+    cache.insert(key, re);
+    return re;
+}
+
+void TextSearch::findAll(const QString& haystack, const QRegularExpression& re, qsizetype from, qsizetype to, int maxMatches, QVector<int>& starts, QVector<int>& lengths,
+                         const std::atomic<bool>* cancelled) {
+    starts.clear();
+    lengths.clear();
+
+    QRegularExpressionMatchIterator it = re.globalMatch(haystack, from);
+    while (it.hasNext() && starts.size() < maxMatches) {
+        if (cancelled && (starts.size() & 0xFFF) == 0 && *cancelled) {
+            break;
+        }
+        const QRegularExpressionMatch match = it.next();
+        if (match.capturedEnd() > to) {
+            break;
+        }
+        starts.append(static_cast<int>(match.capturedStart()));
+        lengths.append(static_cast<int>(match.capturedLength()));
+    }
+}
+
+TextSearch::Replacement TextSearch::replaceAll(const QString& haystack, const QRegularExpression& re, qsizetype from, qsizetype to, QStringView replacement,
+                                               const std::atomic<bool>* cancelled) {
+    Replacement result;
+    const QVector<TemplatePart> parts = parseTemplate(replacement);
+    const QStringView text(haystack);
+
+    qsizetype end = -1;
+    QRegularExpressionMatchIterator it = re.globalMatch(haystack, from);
+    while (it.hasNext()) {
+        if (cancelled && (result.count & 0xFFF) == 0 && *cancelled) {
+            return Replacement();
+        }
+        const QRegularExpressionMatch match = it.next();
+        if (match.capturedEnd() > to) {
+            break;
+        }
+
+        if (result.count == 0) {
+            result.start = match.capturedStart();
+            end = result.start;
+        }
+        result.text += text.sliced(end, match.capturedStart() - end);
+        appendExpanded(result.text, parts, match);
+        end = match.capturedEnd();
+        ++result.count;
+    }
+    result.end = end;
+    return result;
+}
+
+QString TextSearch::requiredLiteral(const QString& pattern) {
+    if (pattern.contains(QLatin1Char('|')) || pattern.contains(QLatin1String("(?"))) {
+        return QString();
+    }
+
+    QString best;
+    QString run;
+    int depth = 0;
+    auto endRun = [&]() {
+        if (run.size() > best.size()) {
+            best = run;
+        }
+        run.clear();
+    };
+
+    for (qsizetype i = 0; i < pattern.size(); ++i) {
+        const QChar c = pattern[i];
+        if (c == QLatin1Char('\\')) {
+            // An escaped letter or digit is a class, an assertion or a back reference; anything else is itself.
+            // Escapes with operands, such as \x41, \101, \cA, \p{L} or \Q...\E, give up rather than risk
+            // reading their operands as literal text, since a wrong literal would skip files that match
+            if (++i == pattern.size()) {
+                endRun();
+            }
+            else if (pattern[i].isDigit() || QStringView(u"xcpPNQEogk").contains(pattern[i])) {
+                return QString();
+            }
+            else if (pattern[i].isLetter()) {
+                endRun();
+            }
+            else if (depth == 0) {
+                run += pattern[i];
+            }
+            continue;
+        }
+
+        switch (c.unicode()) {
+            case '(':
+                endRun();
+                ++depth;
+                break;
+            case ')':
+                endRun();
+                --depth;
+                break;
+            case '[':
+                // Skips the class; a ] right after [ or [^ belongs to it
+                endRun();
+                i += i + 1 < pattern.size() && pattern[i + 1] == QLatin1Char('^') ? 2 : 1;
+                if (i < pattern.size() && pattern[i] == QLatin1Char(']')) {
+                    ++i;
+                }
+                while (i < pattern.size() && pattern[i] != QLatin1Char(']')) {
+                    i += pattern[i] == QLatin1Char('\\') ? 2 : 1;
+                }
+                break;
+            case '*':
+            case '?':
+            case '{':
+                // The quantified character may be absent or repeated, so it ends the run without being part of it
+                if (!run.isEmpty()) {
+                    run.chop(1);
+                    if (!run.isEmpty() && run.back().isHighSurrogate()) {
+                        run.chop(1);
+                    }
+                }
+                endRun();
+                if (c == QLatin1Char('{')) {
+                    while (i < pattern.size() && pattern[i] != QLatin1Char('}')) {
+                        ++i;
+                    }
+                }
+                break;
+            case '+':
+            case '.':
+            case '^':
+            case '$':
+            case ']':
+            case '}':
+                endRun();
+                break;
+            default:
+                if (depth == 0) {
+                    run += c;
+                }
+                else {
+                    endRun();
+                }
+                break;
+        }
+    }
+    endRun();
+    return best;
+}
+
+QString TextSearch::expandReplacement(QStringView replacement, const QRegularExpressionMatch& match) {
+    QString out;
+    appendExpanded(out, parseTemplate(replacement), match);
+    return out;
+}
+
+QString TextSearch::withLineBreaks(const QString& text) {
+    QString lines = text;
+    lines.replace(QChar::ParagraphSeparator, QLatin1Char('\n'));
+    return lines;
+}
+
+QString TextSearch::fold(QStringView text) {
+    QString folded(text.size(), Qt::Uninitialized);
+    char16_t* out = reinterpret_cast<char16_t*>(folded.data());
+    const char16_t* in = text.utf16();
+
+    for (qsizetype i = 0; i < text.size(); ++i) {
+        const char16_t c = in[i];
+        if (c < 128) {
+            out[i] = (c >= 'A' && c <= 'Z') ? static_cast<char16_t>(c + 32) : c;
+        }
+        else if (QChar::isSurrogate(c)) {
+            out[i] = c;  // Kept as is, which keeps the length and leaves supplementary characters case sensitive
+        }
+        else {
+            out[i] = static_cast<char16_t>(QChar::toCaseFolded(static_cast<char32_t>(c)));
+        }
+    }
+    return folded;
+}
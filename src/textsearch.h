@@ -0,0 +1,114 @@
+#ifndef TEXTSEARCH_H
+#define TEXTSEARCH_H
+
+#include <QByteArrayView>
+#include <QRegularExpression>
+#include <QString>
+#include <QStringView>
+#include <QVector>
+#include <atomic>
+
+/**
+ * @brief The TextSearch class
+ *        Plain substring search over immutable UTF-16 snapshots. The scan compares
+ *        the first and last character of the needle against eight positions at once
+ *        and only verifies those candidates, so it runs close to memory speed on
+ *        ordinary text. Regular expressions are compiled once per pattern and case
+ *        option and shared through a cache. Every function may run on any thread.
+ */
+class TextSearch {
+   public:
+    // The result of replaceAll(): the text to put over [start, end) of the original
+    struct Replacement {
+        qsizetype start = -1;  // Offset of the first match, -1 if there was none
+        qsizetype end = -1;    // Offset just past the last match
+        QString text;          // The span with every match replaced
+        int count = 0;         // Number of matches replaced
+    };
+
+    /**
+     * @brief Finds the first occurrence of needle at or after from.
+     * @return The offset of the match, or -1.
+     */
+    static qsizetype indexOf(QStringView haystack, QStringView needle, qsizetype from = 0);
+
+    /**
+     * @brief Finds the first occurrence of needle in raw bytes, such as a mapped file.
+     *        Used as a prefilter before a file is decoded; a case-insensitive search
+     *        only folds ASCII letters.
+     * @return The byte offset of the match, or -1.
+     */
+    static qsizetype indexOf(QByteArrayView haystack, QByteArrayView needle, Qt::CaseSensitivity cs, qsizetype from = 0);
+
+    /**
+     * @brief Finds every occurrence of needle, overlapping ones included.
+     * @param maxMatches The search stops once this many matches were found.
+     * @param cancelled Checked between windows of the haystack; the result is partial once it is set.
+     * @return The match offsets in ascending order.
+     */
+    static QVector<int> findAll(QStringView haystack, QStringView needle, int maxMatches, const std::atomic<bool>* cancelled = nullptr);
+
+    /**
+     * @brief Keeps the candidates at which needle occurs.
+     *        The occurrences of a needle are a subset of those of any of its prefixes,
+     *        so a search that grows by a character only has to check the previous matches.
+     */
+    static QVector<int> narrow(QStringView haystack, QStringView needle, const QVector<int>& candidates, const std::atomic<bool>* cancelled = nullptr);
+
+    /**
+     * @brief Replaces every non-overlapping occurrence of needle in one left-to-right pass.
+     *        Only the span from the first to the last match is rebuilt, so applying the
+     *        result touches as little of the document as possible.
+     * @param text The text to rebuild.
+     * @param haystack text itself, or its fold() for a case-insensitive search.
+     * @param needle The string to find in haystack.
+     * @param replacement The string each match is replaced with.
+     */
+    static Replacement replaceAll(QStringView text, QStringView haystack, QStringView needle, QStringView replacement);
+
+    /**
+     * @brief Returns the compiled, JIT-optimized expression for a pattern.
+     *        Expressions are cached by pattern and case option, so repeated searches with
+     *        the same pattern never recompile it. ^ and $ match at line boundaries.
+     */
+    static QRegularExpression regex(const QString& pattern, Qt::CaseSensitivity cs);
+
+    /**
+     * @brief Finds every match of re that lies within [from, to) of haystack.
+     * @param starts Receives the match offsets in ascending order.
+     * @param lengths Receives the length of each match.
+     */
+    static void findAll(const QString& haystack, const QRegularExpression& re, qsizetype from, qsizetype to, int maxMatches, QVector<int>& starts, QVector<int>& lengths,
+                        const std::atomic<bool>* cancelled = nullptr);
+
+    /**
+     * @brief Replaces every match of re within [from, to) in one pass, like the plain replaceAll().
+     * @param replacement The replacement template; \\0 to \\9 and \\g<name> insert captured groups,
+     *        \\n and \\t insert a line break and a tab, and a backslash escapes any other character.
+     */
+    static Replacement replaceAll(const QString& haystack, const QRegularExpression& re, qsizetype from, qsizetype to, QStringView replacement,
+                                  const std::atomic<bool>* cancelled = nullptr);
+
+    /**
+     * @brief Returns the longest run of literal characters every match of pattern must contain.
+     *        Only runs outside groups count, and patterns with alternation or inline options
+     *        yield none, so a text without the run can never match the pattern.
+     * @return The literal, or an empty string if none is known.
+     */
+    static QString requiredLiteral(const QString& pattern);
+
+    // Expands a replacement template, as described for replaceAll(), for one match
+    static QString expandReplacement(QStringView replacement, const QRegularExpressionMatch& match);
+
+    // Replaces paragraph separators with \n so that a snapshot from QTextDocument::toRawText() suits line anchors; offsets are kept
+    static QString withLineBreaks(const QString& text);
+
+    /**
+     * @brief Case folds text one UTF-16 unit at a time.
+     *        The result has the same length as text, so offsets found in folded copies
+     *        are valid in the originals and a case-insensitive search becomes an exact one.
+     */
+    static QString fold(QStringView text);
+};
+
+#endif  // TEXTSEARCH_H
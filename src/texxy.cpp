@@ -1,28 +1,42 @@
 #include "texxy.h"
 #include "language_support.h"
-#include "languages.cpp"
+#include "documentsaver.h"
+#include "fileloader.h"
+#include "filesearch.h"
+#include "findinfilesdialog.h"
 #include "findreplacedialog.h"
+#include "highlightscheduler.h"
+#include "languages.h"
+#include "largefileview.h"
+#include "mappedfile.h"
+#include "multidocumentsearch.h"
+#include "searchresultspanel.h"
+#include "startupprofile.h"
+#include "swapjournal.h"
+#include "trace.h"
 #include <QAction>
+#include <QDir>
+#include <QDockWidget>
 #include <QFileDialog>
+#include <QFileSystemWatcher>
 #include <QMenuBar>
 #include <QMenu>
 #include <QMessageBox>
-#include <QMimeDatabase>
 #include <QStatusBar>
-#include <QTextStream>
 #include <QTextCursor>
 #include <QTextDocument>
 #include <QFileInfo>
+#include <QSignalBlocker>
+#include <QTimer>
 #include <QApplication>
 
 Texxy::Texxy(QWidget* parent) : QMainWindow(parent) {
     tabWidget = new QTabWidget(this);
     setCentralWidget(tabWidget);
 
-    QIcon appIcon("/usr/share/icons/hicolor/256x256/apps/texxy.png");
-    setWindowIcon(appIcon);
-
-    createNewTab();
+    // Resolved by the icon theme when the icon is first drawn, not read from disk here; the installed
+    // file, also loaded on demand, stands in where the theme has no texxy icon
+    setWindowIcon(QIcon::fromTheme(QStringLiteral("texxy"), QIcon(QStringLiteral("/usr/share/icons/hicolor/256x256/apps/texxy.png"))));
 
     QAction* newAction = new QAction(tr("&New"), this);
     QAction* openAction = new QAction(tr("&Open..."), this);
@@ -30,6 +44,7 @@ Texxy::Texxy(QWidget* parent) : QMainWindow(parent) {
     QAction* saveAsAction = new QAction(tr("Save &As..."), this);
     QAction* exitAction = new QAction(tr("E&xit"), this);
     QAction* findReplaceAction = new QAction(tr("Find/Replace..."), this);
+    QAction* findInFilesAction = new QAction(tr("Find in Files..."), this);
     QAction* closeTabAction = new QAction(tr("Close Tab"), this);
 
     newAction->setShortcut(QKeySequence::New);
@@ -37,6 +52,7 @@ Texxy::Texxy(QWidget* parent) : QMainWindow(parent) {
     saveAction->setShortcut(QKeySequence::Save);
     saveAsAction->setShortcut(QKeySequence::SaveAs);
     closeTabAction->setShortcut(QKeySequence("Ctrl+W"));
+    findInFilesAction->setShortcut(QKeySequence("Ctrl+Shift+F"));
 
     connect(newAction, &QAction::triggered, this, &Texxy::newFile);
     connect(openAction, &QAction::triggered, this, &Texxy::openFile);
@@ -44,6 +60,7 @@ Texxy::Texxy(QWidget* parent) : QMainWindow(parent) {
     connect(saveAsAction, &QAction::triggered, this, &Texxy::saveFileAs);
     connect(exitAction, &QAction::triggered, this, &QMainWindow::close);
     connect(findReplaceAction, &QAction::triggered, this, &Texxy::showFindReplace);
+    connect(findInFilesAction, &QAction::triggered, this, &Texxy::showFindInFiles);
     connect(closeTabAction, &QAction::triggered, this, &Texxy::closeCurrentTab);
 
     QMenu* fileMenu = menuBar()->addMenu(tr("&File"));
@@ -53,31 +70,102 @@ Texxy::Texxy(QWidget* parent) : QMainWindow(parent) {
     fileMenu->addAction(saveAsAction);
     fileMenu->addAction(closeTabAction);
 
+    // Its actions are only built when the menu is first opened after a change
     recentFilesMenu = fileMenu->addMenu(tr("Open Recent"));
+    connect(recentFilesMenu, &QMenu::aboutToShow, this, &Texxy::populateRecentFilesMenu);
     updateRecentFilesMenu();
     fileMenu->addSeparator();
     fileMenu->addAction(exitAction);
 
     QMenu* editMenu = menuBar()->addMenu(tr("&Edit"));
     editMenu->addAction(findReplaceAction);
+    editMenu->addAction(findInFilesAction);
+
+    QAction* traceAction = new QAction(tr("Record &Trace"), this);
+    traceAction->setCheckable(true);
+    traceAction->setChecked(Trace::isEnabled());
+    connect(traceAction, &QAction::toggled, this, &Texxy::toggleTracing);
+
+    followAction = new QAction(tr("&Follow File"), this);
+    followAction->setCheckable(true);
+    connect(followAction, &QAction::toggled, this, &Texxy::toggleFollow);
+
+    QMenu* toolsMenu = menuBar()->addMenu(tr("&Tools"));
+    toolsMenu->addAction(followAction);
+    toolsMenu->addAction(traceAction);
 
     statusLabel = new QLabel(this);
     statusBar()->addPermanentWidget(statusLabel);
 
-    findReplaceDialog = new FindReplaceDialog(this);
-    findReplaceDialog->setTextEdit(currentTextEdit());
+    connect(tabWidget, &QTabWidget::currentChanged, this, &Texxy::currentTabChanged);
 
-    connect(tabWidget, &QTabWidget::currentChanged, this, [this](int) {
-        findReplaceDialog->setTextEdit(currentTextEdit());
-        updateCursorPosition();
-        updateWindowTitle();
-    });
+    fileWatcher = new QFileSystemWatcher(this);
+    connect(fileWatcher, &QFileSystemWatcher::fileChanged, this, &Texxy::fileChangedOnDisk);
 
     setWindowTitle(tr("Untitled - texxy"));
     resize(900, 600);
+    StartupProfile::mark("menus and actions");
 
     loadSettings();
+    StartupProfile::mark("settings");
+
+    if (!restoreSession()) {
+        createNewTab();
+    }
+    updateCursorPosition();
+    StartupProfile::mark("first tab");
+
+    if (QPlainTextEdit* edit = currentTextEdit()) {
+        StartupProfile::watchFirstPaint(edit->viewport());
+    }
+
+    // Asked once the window is up rather than before it appears
+    QTimer::singleShot(0, this, &Texxy::recoverJournals);
+}
+
+void Texxy::currentTabChanged() {
+    TRACE_SCOPE("Texxy::currentTabChanged");
+    EditorWidget* ew = currentEditorWidget();
+    if (ew && ew->isDeferredLoad()) {
+        ew->setDeferredLoad(false);
+        loadFile(ew->filePath());
+    }
+    if (findReplaceDialog) {
+        findReplaceDialog->setEditor(ew);
+    }
+    {
+        const QSignalBlocker blocker(followAction);
+        followAction->setChecked(ew && ew->isFollowing());
+    }
     updateCursorPosition();
+    updateWindowTitle();
+}
+
+void Texxy::recoverJournals() {
+    for (const QString& journal : SwapJournal::orphanedJournals()) {
+        SwapJournal::Recovery recovery;
+        QString error;
+        if (!SwapJournal::recover(journal, &recovery, &error)) {
+            QMessageBox::warning(this, tr("Error"), tr("Cannot recover unsaved changes from %1\n%2").arg(journal, error));
+            SwapJournal::discard(journal);
+            continue;
+        }
+
+        const QString name = recovery.filePath.isEmpty() ? tr("Untitled") : recovery.filePath;
+        if (QMessageBox::question(this, tr("Recover Changes"), tr("texxy did not quit normally. Recover the unsaved changes to %1?").arg(name)) != QMessageBox::Yes) {
+            SwapJournal::discard(journal);
+            continue;
+        }
+
+        // The new tab's journal holds the recovered text before the old one goes
+        EditorWidget* ew = qobject_cast<EditorWidget*>(tabWidget->widget(createNewTab(recovery.filePath, recovery.text)));
+        ew->textEdit()->document()->setModified(true);
+        ew->swapJournal()->checkpoint();
+        if (const LanguageDefinition* lang = LanguageRegistry::instance().forFileName(recovery.filePath)) {
+            ew->setHighlighter(lang->highlighterFactory(ew->textEdit()->document()));
+        }
+        SwapJournal::discard(journal);
+    }
 }
 
 void Texxy::closeCurrentTab() {
@@ -94,6 +182,7 @@ void Texxy::closeCurrentTab() {
 void Texxy::closeEvent(QCloseEvent* event) {
     if (maybeSaveChanges()) {
         saveSettings();
+        saveSession();
         event->accept();
     }
     else {
@@ -151,12 +240,241 @@ void Texxy::openRecentFile() {
 }
 
 void Texxy::showFindReplace() {
+    if (!findReplaceDialog) {
+        findReplaceDialog = new FindReplaceDialog(this);
+        findReplaceDialog->setEditor(currentEditorWidget());
+        connect(findReplaceDialog, &FindReplaceDialog::searchInTabsRequested, this, &Texxy::searchInTabs);
+        connect(findReplaceDialog, &FindReplaceDialog::replaceInTabsRequested, this, &Texxy::replaceInTabs);
+    }
     findReplaceDialog->show();
     findReplaceDialog->raise();
     findReplaceDialog->activateWindow();
 }
 
+SearchResultsPanel* Texxy::searchResultsPanel() {
+    if (!searchResultsDock) {
+        tabSearch = new MultiDocumentSearch(this);
+        searchResults = new SearchResultsPanel(this);
+        searchResultsDock = new QDockWidget(tr("Search Results"), this);
+        searchResultsDock->setObjectName("searchResultsDock");
+        searchResultsDock->setWidget(searchResults);
+        addDockWidget(Qt::BottomDockWidgetArea, searchResultsDock);
+
+        connect(tabSearch, &MultiDocumentSearch::documentSearched, this, [this](EditorWidget* ew, const QVector<MultiDocumentSearch::Hit>& hits, bool capped) {
+            searchResults->addMatches(ew, tabWidget->tabText(tabWidget->indexOf(ew)), hits, capped);
+        });
+        connect(tabSearch, &MultiDocumentSearch::documentReplaced, this,
+                [this](EditorWidget* ew, int count) { searchResults->addReplaced(ew, tabWidget->tabText(tabWidget->indexOf(ew)), count); });
+        connect(tabSearch, &MultiDocumentSearch::documentSkipped, this,
+                [this](EditorWidget* ew, const QString& reason) { searchResults->addSkipped(ew, tabWidget->tabText(tabWidget->indexOf(ew)), reason); });
+        connect(tabSearch, &MultiDocumentSearch::finished, searchResults, &SearchResultsPanel::finish);
+        connect(searchResults, &SearchResultsPanel::matchActivated, this, &Texxy::showSearchMatch);
+        connect(searchResults, &SearchResultsPanel::fileMatchActivated, this, &Texxy::openFileAtLine);
+    }
+    searchResultsDock->show();
+    return searchResults;
+}
+
+QList<EditorWidget*> Texxy::editorWidgets() const {
+    QList<EditorWidget*> editors;
+    for (int i = 0; i < tabWidget->count(); ++i) {
+        if (EditorWidget* ew = qobject_cast<EditorWidget*>(tabWidget->widget(i))) {
+            editors.append(ew);
+        }
+    }
+    return editors;
+}
+
+void Texxy::searchInTabs(const QString& pattern, Qt::CaseSensitivity cs, bool regex) {
+    TRACE_SCOPE("Texxy::searchInTabs");
+    SearchResultsPanel* panel = searchResultsPanel();
+    if (fileSearch) {
+        fileSearch->cancel();
+        findInFilesDialog->setRunning(false);
+    }
+    panel->beginSearch(pattern);
+    if (!tabSearch->search(editorWidgets(), pattern, cs, regex)) {
+        panel->showError(tabSearch->errorString().isEmpty() ? QString() : tr("Invalid pattern: %1").arg(tabSearch->errorString()));
+    }
+}
+
+void Texxy::replaceInTabs(const QString& pattern, Qt::CaseSensitivity cs, bool regex, const QString& replacement) {
+    TRACE_SCOPE("Texxy::replaceInTabs");
+    SearchResultsPanel* panel = searchResultsPanel();
+    if (fileSearch) {
+        fileSearch->cancel();
+        findInFilesDialog->setRunning(false);
+    }
+    panel->beginReplace(pattern);
+    if (!tabSearch->replaceAll(editorWidgets(), pattern, cs, regex, replacement)) {
+        panel->showError(tabSearch->errorString().isEmpty() ? QString() : tr("Invalid pattern: %1").arg(tabSearch->errorString()));
+    }
+}
+
+void Texxy::showFindInFiles() {
+    if (!findInFilesDialog) {
+        fileSearch = new FileSearch(this);
+        findInFilesDialog = new FindInFilesDialog(this);
+        connect(findInFilesDialog, &FindInFilesDialog::searchRequested, this, &Texxy::searchInFiles);
+        connect(findInFilesDialog, &FindInFilesDialog::stopRequested, this, [this]() {
+            fileSearch->cancel();
+            findInFilesDialog->setRunning(false);
+            findInFilesDialog->setStatus(tr("Stopped"));
+            searchResults->finish();
+        });
+        connect(fileSearch, &FileSearch::resultsReady, this, [this](const QVector<FileSearch::FileResult>& results) {
+            for (const FileSearch::FileResult& result : results) {
+                searchResults->addFileMatches(result.path, result.hits, result.capped);
+            }
+        });
+        connect(fileSearch, &FileSearch::progress, this, [this](qint64 files, qint64 bytes) { searchResults->setProgress(files, bytes); });
+        connect(fileSearch, &FileSearch::finished, this, [this]() {
+            findInFilesDialog->setRunning(false);
+            findInFilesDialog->setStatus(QString());
+            searchResults->finish();
+        });
+    }
+
+    const QString path = currentFilePath();
+    findInFilesDialog->setDirectory(path.isEmpty() ? QDir::currentPath() : QFileInfo(path).absolutePath());
+    findInFilesDialog->show();
+    findInFilesDialog->raise();
+    findInFilesDialog->activateWindow();
+}
+
+void Texxy::searchInFiles(const QString& root, const QString& pattern, Qt::CaseSensitivity cs, bool regex, const FileSearch::Options& options) {
+    SearchResultsPanel* panel = searchResultsPanel();
+    tabSearch->cancel();
+    panel->beginFileSearch(pattern, root);
+    if (!fileSearch->start(root, pattern, cs, regex, options)) {
+        const QString error = fileSearch->errorString().isEmpty() ? QString() : tr("Invalid pattern: %1").arg(fileSearch->errorString());
+        panel->showError(error);
+        findInFilesDialog->setStatus(error);
+        return;
+    }
+    findInFilesDialog->setRunning(true);
+    findInFilesDialog->setStatus(tr("Searching..."));
+}
+
+void Texxy::openFileAtLine(const QString& path, int line, int column) {
+    const QFileInfo target(path);
+    for (EditorWidget* ew : editorWidgets()) {
+        if (!ew->filePath().isEmpty() && QFileInfo(ew->filePath()) == target) {
+            tabWidget->setCurrentWidget(ew);
+            ew->goToLine(line, column);
+            return;
+        }
+    }
+
+    // Opened through the usual path; the editor moves to the line once the file has loaded
+    createNewTab(path);
+    loadFile(path);
+    addToRecentFiles(path);
+    if (EditorWidget* ew = currentEditorWidget()) {
+        ew->goToLine(line, column);
+    }
+}
+
+void Texxy::toggleTracing(bool enabled) {
+    Trace::setEnabled(enabled);
+    if (enabled) {
+        return;
+    }
+
+    const QString path = QFileDialog::getSaveFileName(this, tr("Save Trace"), QStringLiteral("texxy-trace.json"), tr("Chrome trace (*.json)"));
+    QString error;
+    if (!path.isEmpty() && !Trace::writeChromeTrace(path, &error)) {
+        QMessageBox::warning(this, tr("Error"), tr("Cannot save trace: %1\n%2").arg(path, error));
+    }
+}
+
+void Texxy::toggleFollow(bool enabled) {
+    EditorWidget* ew = currentEditorWidget();
+    if (ew && ew->setFollowing(enabled)) {
+        return;
+    }
+
+    const QSignalBlocker blocker(followAction);
+    followAction->setChecked(false);
+    if (ew) {
+        QMessageBox::warning(this, tr("Error"), tr("Only a saved file that is not in large file mode and has no unsaved changes can be followed."));
+    }
+}
+
+void Texxy::fileChangedOnDisk(const QString& path) {
+    // Files replaced rather than rewritten, as QSaveFile and version control do, drop out of the watcher
+    if (QFileInfo::exists(path) && !fileWatcher->files().contains(path)) {
+        fileWatcher->addPath(path);
+    }
+
+    // The question below runs an event loop, in which a tab can be closed
+    QList<QPointer<EditorWidget>> editors;
+    for (EditorWidget* ew : editorWidgets()) {
+        editors.append(ew);
+    }
+
+    bool open = false;
+    for (const QPointer<EditorWidget>& ew : editors) {
+        if (!ew || ew->filePath() != path) {
+            continue;
+        }
+        open = true;
+
+        // Deferred tabs read the file when first shown, and followed ones pick up the change themselves
+        if (ew->isDeferredLoad() || ew->isLargeFileMode() || ew->isLoading() || ew->isFollowing() || !QFileInfo::exists(path) || ew->isSyncedWithFile()) {
+            continue;
+        }
+        if (ew->textEdit()->document()->isModified()) {
+            if (reloadPrompts.contains(path)) {
+                continue;
+            }
+            reloadPrompts.insert(path);
+            const QMessageBox::StandardButton answer = QMessageBox::question(
+                this, tr("File Changed"), tr("%1 was changed by another program. Reload it? Your unsaved changes can still be undone.").arg(path));
+            reloadPrompts.remove(path);
+            if (!ew) {
+                continue;
+            }
+            if (answer != QMessageBox::Yes) {
+                ew->markSynced();  // Asked again only after the next change
+                continue;
+            }
+        }
+        ew->reloadFromDisk();
+    }
+
+    if (!open) {
+        fileWatcher->removePath(path);
+    }
+}
+
+void Texxy::showSearchMatch(EditorWidget* editor, int position, int length) {
+    if (editor->isLargeFileMode()) {
+        return;
+    }
+    tabWidget->setCurrentWidget(editor);
+
+    // The document may have been edited since the search, so the match is clamped to its end
+    QPlainTextEdit* edit = editor->textEdit();
+    const int end = edit->document()->characterCount() - 1;
+    QTextCursor cursor(edit->document());
+    cursor.setPosition(qMin(position, end));
+    cursor.setPosition(qMin(position + length, end), QTextCursor::KeepAnchor);
+    edit->setTextCursor(cursor);
+    edit->centerCursor();
+    edit->setFocus();
+}
+
 void Texxy::updateCursorPosition() {
+    TRACE_SCOPE("Texxy::updateCursorPosition");
+    EditorWidget* ew = currentEditorWidget();
+    if (ew && ew->isLargeFileMode()) {
+        qint64 line = ew->largeFileView()->cursorLine() + 1;
+        qint64 total = ew->largeFileView()->lineCount();
+        statusLabel->setText(tr("Line: %1 of %2").arg(line).arg(total));
+        return;
+    }
+
     QPlainTextEdit* edit = currentTextEdit();
     if (!edit) {
         statusLabel->setText(tr("Line: -, Col: -"));
@@ -172,8 +490,8 @@ void Texxy::updateWindowTitle() {
     QString path = currentFilePath();
     QString title = path.isEmpty() ? tr("Untitled") : QFileInfo(path).fileName();
 
-    QPlainTextEdit* edit = currentTextEdit();
-    if (edit && edit->document()->isModified()) {
+    EditorWidget* ew = currentEditorWidget();
+    if (ew && ew->isModified()) {
         title += "*";
     }
     setWindowTitle(title + tr(" - texxy"));
@@ -182,7 +500,15 @@ void Texxy::updateWindowTitle() {
 int Texxy::createNewTab(const QString& filePath, const QString& content) {
     EditorWidget* editorWidget = new EditorWidget(this);
     editorWidget->setFilePath(filePath);
-    editorWidget->textEdit()->setStyleSheet("QPlainTextEdit { background-color: #000; color: #FFF; }");
+    if (QFileInfo::exists(filePath)) {
+        fileWatcher->addPath(filePath);
+    }
+
+    // A palette instead of a style sheet spares every new tab a style sheet parse and repolish
+    QPalette palette = editorWidget->textEdit()->palette();
+    palette.setColor(QPalette::Base, Qt::black);
+    palette.setColor(QPalette::Text, Qt::white);
+    editorWidget->textEdit()->setPalette(palette);
 
     if (!content.isEmpty()) {
         editorWidget->textEdit()->setPlainText(content);
@@ -219,6 +545,9 @@ void Texxy::setCurrentFilePath(const QString& path) {
         return;
 
     ew->setFilePath(path);
+    if (QFileInfo::exists(path)) {
+        fileWatcher->addPath(path);
+    }
 
     int idx = tabWidget->indexOf(ew);
     if (idx >= 0) {
@@ -228,11 +557,11 @@ void Texxy::setCurrentFilePath(const QString& path) {
 }
 
 bool Texxy::maybeSaveChanges() {
-    QPlainTextEdit* edit = currentTextEdit();
-    if (!edit)
+    EditorWidget* ew = currentEditorWidget();
+    if (!ew)
         return true;
 
-    if (!edit->document()->isModified())
+    if (!ew->isModified())
         return true;
 
     auto ret =
@@ -248,58 +577,100 @@ bool Texxy::maybeSaveChanges() {
 }
 
 void Texxy::loadFile(const QString& filePath) {
-    QFile file(filePath);
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        QMessageBox::warning(this, tr("Error"), tr("Cannot open file: %1").arg(filePath));
+    TRACE_SCOPE("Texxy::loadFile");
+    EditorWidget* ew = currentEditorWidget();
+    if (!ew)
         return;
-    }
-    QTextStream in(&file);
-    QString content = in.readAll();
-    file.close();
 
-    QPlainTextEdit* edit = currentTextEdit();
-    if (!edit)
-        return;
+    if (QFileInfo(filePath).size() >= LargeFileThreshold) {
+        if (!ew->openLargeFile(filePath)) {
+            QMessageBox::warning(this, tr("Error"), tr("Cannot open file: %1").arg(filePath));
+            return;
+        }
+        connect(ew->largeFileView(), &LargeFileView::visibleLinesChanged, this, &Texxy::updateCursorPosition, Qt::UniqueConnection);
+        connect(ew->largeFileView(), &LargeFileView::modificationChanged, this, &Texxy::updateWindowTitle, Qt::UniqueConnection);
 
-    edit->setPlainText(content);
-    edit->document()->setModified(false);
+        setCurrentFilePath(filePath);
+        updateWindowTitle();
+        updateCursorPosition();
+        return;
+    }
 
     setCurrentFilePath(filePath);
-    updateWindowTitle();
 
-    if (highlighter) {
-        delete highlighter;
-        highlighter = nullptr;
-    }
+    // Attaching the highlighter while the document is still empty keeps QSyntaxHighlighter
+    // from highlighting the whole file in one go; the scheduler highlights chunks as they land
+    const LanguageDefinition* lang = LanguageRegistry::instance().forFileName(filePath);
+    ew->setHighlighter(lang ? lang->highlighterFactory(ew->textEdit()->document()) : nullptr);
 
-    QMimeDatabase db;
-    QMimeType mime = db.mimeTypeForFile(filePath, QMimeDatabase::MatchContent);
+    // Reading, decoding and MIME sniffing run on a worker; the tab fills in as chunks arrive
+    FileLoader* loader = new FileLoader(filePath);
+    loader->setSniffContent(!lang);
+    ew->startLoading(loader);
 
-    const LanguageDefinition* lang = findMatchingLanguage(mime, filePath.toLower());
-    if (lang) {
-        highlighter = lang->highlighterFactory(edit->document());
-    }
+    connect(loader, &FileLoader::failed, this, [this, filePath](const QString&) {
+        QMessageBox::warning(this, tr("Error"), tr("Cannot open file: %1").arg(filePath));
+    });
+
+    connect(loader, &FileLoader::cancelled, this, [this, ew]() {
+        int idx = tabWidget->indexOf(ew);
+        if (idx >= 0) {
+            tabWidget->removeTab(idx);
+            ew->deleteLater();
+        }
+    });
+
+    connect(loader, &FileLoader::finished, this, [this, ew, lang](const QMimeType& mime) {
+        updateWindowTitle();
+
+        // Content sniffing can still find a language the extension did not reveal
+        if (!lang) {
+            if (const LanguageDefinition* sniffed = LanguageRegistry::instance().forMimeType(mime)) {
+                ew->setHighlighter(sniffed->highlighterFactory(ew->textEdit()->document()));
+            }
+        }
+    });
+
+    loader->start();
 }
 
 bool Texxy::saveToPath(const QString& filePath) {
+    TRACE_SCOPE("Texxy::saveToPath");
+    EditorWidget* ew = currentEditorWidget();
+    if (ew && ew->isLargeFileMode()) {
+        // The pieces are streamed from the mapping and the edit buffer, so the file never has to fit in memory
+        LargeFileView* view = ew->largeFileView();
+        if (filePath == view->mappedFile()->filePath() && !view->isModified())
+            return true;
+
+        QString error;
+        if (!view->save(filePath, &error)) {
+            QMessageBox::warning(this, tr("Error"), tr("Cannot save file: %1\n%2").arg(filePath, error));
+            return false;
+        }
+        setCurrentFilePath(filePath);
+        updateWindowTitle();
+        return true;
+    }
+
+    if (ew && ew->isLoading()) {
+        QMessageBox::warning(this, tr("Error"), tr("Cannot save file while it is still loading: %1").arg(filePath));
+        return false;
+    }
+
     QPlainTextEdit* edit = currentTextEdit();
     if (!edit)
         return false;
 
-    QFile file(filePath);
-    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
-        QMessageBox::warning(this, tr("Error"), tr("Cannot save file: %1").arg(filePath));
+    QString error;
+    if (!DocumentSaver::save(edit->document(), filePath, &error)) {
+        QMessageBox::warning(this, tr("Error"), tr("Cannot save file: %1\n%2").arg(filePath, error));
         return false;
     }
-    QTextStream out(&file);
-#if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
-    out.setCodec("UTF-8");
-#endif
-    out << edit->toPlainText();
-    file.close();
 
     edit->document()->setModified(false);
     setCurrentFilePath(filePath);
+    ew->markSynced();
     updateWindowTitle();
     return true;
 }
@@ -314,14 +685,24 @@ void Texxy::addToRecentFiles(const QString& filePath) {
 }
 
 void Texxy::updateRecentFilesMenu() {
-    recentFilesMenu->clear();
+    // Deleted later, since this can run from the triggered() of one of them
+    for (QAction* act : recentFilesMenu->actions()) {
+        recentFilesMenu->removeAction(act);
+        act->deleteLater();
+    }
+    recentFilesMenu->setEnabled(!recentFiles.isEmpty());
+}
+
+void Texxy::populateRecentFilesMenu() {
+    if (!recentFilesMenu->isEmpty()) {
+        return;
+    }
     for (const QString& f : recentFiles) {
-        QAction* act = new QAction(QFileInfo(f).fileName(), this);
+        QAction* act = new QAction(QFileInfo(f).fileName(), recentFilesMenu);
         act->setData(f);
         connect(act, &QAction::triggered, this, &Texxy::openRecentFile);
         recentFilesMenu->addAction(act);
     }
-    recentFilesMenu->setEnabled(!recentFiles.isEmpty());
 }
 
 void Texxy::loadSettings() {
@@ -335,9 +716,65 @@ void Texxy::saveSettings() {
     settings.setValue("recentFiles", recentFiles);
 }
 
-int main(int argc, char* argv[]) {
-    QApplication app(argc, argv);
-    Texxy editor;
-    editor.show();
-    return app.exec();
+bool Texxy::restoreSession() {
+    QSettings settings("MyCompany", "Texxy");
+    settings.beginGroup("session");
+    const int current = settings.value("current").toInt();
+
+    // Every tab is created empty; only the one that ends up current reads its file
+    EditorWidget* currentEditor = nullptr;
+    {
+        const QSignalBlocker blocker(tabWidget);
+        const int count = settings.beginReadArray("tabs");
+        for (int i = 0; i < count; ++i) {
+            settings.setArrayIndex(i);
+            const QString path = settings.value("path").toString();
+            if (path.isEmpty() || !QFileInfo::exists(path)) {
+                continue;
+            }
+
+            EditorWidget* ew = qobject_cast<EditorWidget*>(tabWidget->widget(createNewTab(path)));
+            ew->setDeferredLoad(true);
+            ew->setViewState({settings.value("cursor").toInt(), settings.value("scroll").toInt()});
+            if (i <= current || !currentEditor) {
+                currentEditor = ew;
+            }
+        }
+        settings.endArray();
+    }
+    settings.endGroup();
+
+    if (!currentEditor) {
+        return false;
+    }
+    tabWidget->setCurrentWidget(currentEditor);
+    currentTabChanged();
+    return true;
+}
+
+void Texxy::saveSession() {
+    QSettings settings("MyCompany", "Texxy");
+    settings.beginGroup("session");
+    settings.remove("");
+
+    // Untitled tabs have nothing to reopen from
+    int index = 0;
+    int current = 0;
+    settings.beginWriteArray("tabs");
+    for (EditorWidget* ew : editorWidgets()) {
+        if (ew->filePath().isEmpty()) {
+            continue;
+        }
+        if (ew == currentEditorWidget()) {
+            current = index;
+        }
+        const EditorWidget::ViewState state = ew->viewState();
+        settings.setArrayIndex(index++);
+        settings.setValue("path", ew->filePath());
+        settings.setValue("cursor", state.cursorPosition);
+        settings.setValue("scroll", state.scrollValue);
+    }
+    settings.endArray();
+    settings.setValue("current", current);
+    settings.endGroup();
 }
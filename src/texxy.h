@@ -5,9 +5,11 @@
 #include <QProcess>
 #include <QTabWidget>
 #include <QPlainTextEdit>
+#include <QSet>
 #include <QSettings>
 
 #include "editorwidget.h"
+#include "filesearch.h"
 #include "findreplacedialog.h"
 #include "language_support.h"
 
@@ -15,8 +17,13 @@ class EditorWidget;  // forward declaration
 class QLabel;
 class QMenu;
 class FindReplaceDialog;
+class FindInFilesDialog;
 class QCloseEvent;
+class QDockWidget;
+class QFileSystemWatcher;
 class QMimeType;
+class MultiDocumentSearch;
+class SearchResultsPanel;
 
 class Texxy : public QMainWindow {
     Q_OBJECT
@@ -24,6 +31,8 @@ class Texxy : public QMainWindow {
     explicit Texxy(QWidget* parent = nullptr);  // Initializes the main window and UI components.
     ~Texxy() override = default;                // Default destructor.
 
+    static const qint64 LargeFileThreshold = 64 * 1024 * 1024;  // Files at least this big open in the memory-mapped viewer.
+
    protected:
     void closeEvent(QCloseEvent* event) override;  // Handles window close event with unsaved changes check.
 
@@ -34,8 +43,21 @@ class Texxy : public QMainWindow {
     bool saveFileAs();            // Prompts the user to select a file path to save the document.
     void openRecentFile();        // Opens a recent file from the recent files menu.
     void showFindReplace();       // Opens the Find/Replace dialog.
+    void showFindInFiles();       // Opens the Find in Files dialog.
     void updateCursorPosition();  // Updates the cursor position in the status bar.
     void updateWindowTitle();     // Updates window title with the current file name.
+    void currentTabChanged();     // Loads a restored tab on first show and points the dialogs and status bar at it.
+    void toggleTracing(bool enabled);  // Starts recording trace points, or stops and saves them as a Chrome trace.
+    void toggleFollow(bool enabled);   // Turns follow mode of the current tab on or off.
+    void fileChangedOnDisk(const QString& path);  // Reloads the tabs showing a file that another program changed.
+
+    void searchInTabs(const QString& pattern, Qt::CaseSensitivity cs, bool regex);                               // Lists the matches of every tab.
+    void replaceInTabs(const QString& pattern, Qt::CaseSensitivity cs, bool regex, const QString& replacement);  // Replace All in every tab.
+    void showSearchMatch(EditorWidget* editor, int position, int length);                                        // Selects a listed match.
+    void openFileAtLine(const QString& path, int line, int column);                                              // Shows a file, opening it if needed.
+
+    // Lists the matches in every file under root.
+    void searchInFiles(const QString& root, const QString& pattern, Qt::CaseSensitivity cs, bool regex, const FileSearch::Options& options);
 
    private:
     int createNewTab(const QString& filePath = QString(), const QString& content = QString());  // Creates and returns a new tab with content.
@@ -46,6 +68,9 @@ class Texxy : public QMainWindow {
     // Returns the current text editor (QPlainTextEdit) widget.
     QPlainTextEdit* currentTextEdit() const;
 
+    QList<EditorWidget*> editorWidgets() const;  // Returns the editor of every tab, in tab order.
+    SearchResultsPanel* searchResultsPanel();    // Creates the search results dock on first use and shows it.
+
     QString currentFilePath() const;               // Returns the file path of the current editor.
     void setCurrentFilePath(const QString& path);  // Sets the file path of the current editor and updates the tab.
     bool maybeSaveChanges();                       // Checks if changes were made and prompts to save if needed.
@@ -54,11 +79,17 @@ class Texxy : public QMainWindow {
     bool saveToPath(const QString& filePath);  // Saves the document to the specified path.
 
     void addToRecentFiles(const QString& filePath);  // Adds the file to the recent files list.
-    void updateRecentFilesMenu();                    // Updates the recent files menu with the latest list.
+    void updateRecentFilesMenu();                    // Drops the menu's actions so the next opening lists the latest files.
+    void populateRecentFilesMenu();                  // Builds the recent file actions when the menu opens without them.
 
     void loadSettings();  // Loads editor settings (recent files, etc.).
     void saveSettings();  // Saves editor settings (recent files, etc.).
 
+    bool restoreSession();  // Reopens the tabs of the last session, loading only the current one. False if there were none.
+    void saveSession();     // Records the open files with their cursor and scroll positions, and the current tab.
+
+    void recoverJournals();  // Offers to restore the unsaved edits that a crash left in swap journals.
+
     void closeCurrentTab();
 
     void applyClangFormat();
@@ -67,12 +98,21 @@ class Texxy : public QMainWindow {
     QTabWidget* tabWidget = nullptr;       // Tab widget to manage multiple editor tabs.
     QLabel* statusLabel = nullptr;         // Status label for displaying the cursor position.
     QMenu* recentFilesMenu = nullptr;      // Menu for managing recent files.
+    QAction* followAction = nullptr;       // Checked while the current tab follows its file.
+
+    QFileSystemWatcher* fileWatcher = nullptr;  // Watches the files of the open tabs for changes made by other programs.
+    QSet<QString> reloadPrompts;                // Files whose "reload?" question is currently shown.
     QStringList recentFiles;               // List of recently opened files.
     static const int MaxRecentFiles = 10;  // Max number of recent files to track.
 
-    FindReplaceDialog* findReplaceDialog = nullptr;  // Dialog for Find/Replace functionality.
+    FindReplaceDialog* findReplaceDialog = nullptr;  // Dialog for Find/Replace functionality, created on first use.
+
+    MultiDocumentSearch* tabSearch = nullptr;     // Searches and replaces across all tabs.
+    QDockWidget* searchResultsDock = nullptr;     // Dock holding searchResults, created on first use.
+    SearchResultsPanel* searchResults = nullptr;  // Results of the last search across tabs.
 
-    QSyntaxHighlighter* highlighter = nullptr;  // Syntax highlighter (if available).
+    FindInFilesDialog* findInFilesDialog = nullptr;  // Dialog for Find in Files, created on first use.
+    FileSearch* fileSearch = nullptr;                // Searches files that do not need to be open.
 };
 
 #endif  // TEXXY_H
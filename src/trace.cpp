@@ -0,0 +1,127 @@
+#include "trace.h"
+#include <QCoreApplication>
+#include <QSaveFile>
+#include <QThread>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace {
+
+struct Event {
+    const char* name;
+    qint64 start;  // Nanoseconds since the first trace point
+    qint64 duration;
+};
+
+// Written only by its own thread; the exporter reads the events published through count
+struct Buffer {
+    int tid = 0;
+    QByteArray threadName;
+    std::unique_ptr<Event[]> events{new Event[Trace::BufferEvents]};
+    std::atomic<quint64> count{0};  // Events ever written; the last BufferEvents of them are kept
+};
+
+std::mutex buffersMutex;                       // Guards buffers; taken once per thread and by the exporter
+std::vector<std::unique_ptr<Buffer>> buffers;  // Never freed, so events of finished threads stay exportable
+
+Buffer* registerThread() {
+    auto buffer = std::make_unique<Buffer>();
+    QThread* thread = QThread::currentThread();
+    if (QCoreApplication::instance() && thread == QCoreApplication::instance()->thread()) {
+        buffer->threadName = "GUI";
+    }
+    else {
+        buffer->threadName = thread->objectName().toUtf8();
+    }
+
+    std::lock_guard<std::mutex> lock(buffersMutex);
+    buffer->tid = static_cast<int>(buffers.size()) + 1;
+    if (buffer->threadName.isEmpty()) {
+        buffer->threadName = "Thread " + QByteArray::number(buffer->tid);
+    }
+    buffers.push_back(std::move(buffer));
+    return buffers.back().get();
+}
+
+void appendEscaped(QByteArray& out, const QByteArray& text) {
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+        }
+        out += static_cast<unsigned char>(c) < 0x20 ? ' ' : c;
+    }
+}
+
+}  // namespace
+
+void Trace::setEnabled(bool enabled) {
+    now();  // Fixes the time origin before the first event
+    s_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+QString Trace::startFromEnvironment() {
+    const QString value = qEnvironmentVariable("TEXXY_TRACE");
+    if (value.isEmpty() || value == QLatin1String("0")) {
+        return QString();
+    }
+    setEnabled(true);
+    return value == QLatin1String("1") ? QStringLiteral("texxy-trace.json") : value;
+}
+
+qint64 Trace::now() {
+    static const auto origin = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - origin).count();
+}
+
+void Trace::record(const char* name, qint64 start, qint64 end) {
+    thread_local Buffer* buffer = registerThread();
+    const quint64 n = buffer->count.load(std::memory_order_relaxed);
+    buffer->events[n % BufferEvents] = {name, start, end - start};
+    buffer->count.store(n + 1, std::memory_order_release);
+}
+
+bool Trace::writeChromeTrace(const QString& path, QString* errorString) {
+    QByteArray json = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool first = true;
+    auto separate = [&]() {
+        if (!first) {
+            json += ",\n";
+        }
+        first = false;
+    };
+
+    {
+        std::lock_guard<std::mutex> lock(buffersMutex);
+        for (const std::unique_ptr<Buffer>& buffer : buffers) {
+            const QByteArray tid = QByteArray::number(buffer->tid);
+            separate();
+            json += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" + tid + ",\"args\":{\"name\":\"";
+            appendEscaped(json, buffer->threadName);
+            json += "\"}}";
+
+            const quint64 count = buffer->count.load(std::memory_order_acquire);
+            const quint64 begin = count > static_cast<quint64>(BufferEvents) ? count - BufferEvents : 0;
+            for (quint64 i = begin; i < count; ++i) {
+                const Event event = buffer->events[i % BufferEvents];
+                separate();
+                json += "{\"name\":\"";
+                appendEscaped(json, event.name);
+                json += "\",\"cat\":\"texxy\",\"ph\":\"X\",\"pid\":1,\"tid\":" + tid;
+                json += ",\"ts\":" + QByteArray::number(event.start / 1000.0, 'f', 3);
+                json += ",\"dur\":" + QByteArray::number(event.duration / 1000.0, 'f', 3) + '}';
+            }
+        }
+    }
+    json += "\n]}\n";
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly) || file.write(json) != json.size() || !file.commit()) {
+        if (errorString) {
+            *errorString = file.errorString();
+        }
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,58 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <QString>
+#include <atomic>
+
+/**
+ * @brief The Trace class
+ *        Scoped trace points on the hot paths, recorded into a fixed ring buffer per
+ *        thread and exported as Chrome trace JSON, which chrome://tracing and Perfetto
+ *        open. A thread only ever writes its own buffer, so recording takes no lock.
+ *        While tracing is off, a trace point costs one relaxed atomic load.
+ */
+class Trace {
+   public:
+    static bool isEnabled() { return s_enabled.load(std::memory_order_relaxed); }
+    static void setEnabled(bool enabled);
+
+    // Turns tracing on if TEXXY_TRACE is set and returns the file the trace should go to at exit:
+    // the variable's value, or texxy-trace.json if it is "1". Returns an empty string otherwise.
+    static QString startFromEnvironment();
+
+    // Writes the events still in the ring buffers; events recorded meanwhile may be missed
+    static bool writeChromeTrace(const QString& path, QString* errorString = nullptr);
+
+    static constexpr int BufferEvents = 1 << 16;  // Events kept per thread; older ones are overwritten
+
+    // Records the time from its construction to its destruction under name, which must be a string literal
+    class Scope {
+       public:
+        explicit Scope(const char* name) : m_name(name), m_start(Trace::isEnabled() ? Trace::now() : -1) {}
+        ~Scope() {
+            if (m_start >= 0) {
+                Trace::record(m_name, m_start, Trace::now());
+            }
+        }
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+       private:
+        const char* m_name;
+        qint64 m_start;  // Nanoseconds, or -1 if tracing was off when the scope began
+    };
+
+   private:
+    static qint64 now();  // Nanoseconds since the first trace point
+    static void record(const char* name, qint64 start, qint64 end);
+
+    static inline std::atomic<bool> s_enabled{false};
+};
+
+#define TEXXY_TRACE_CONCAT_(a, b) a##b
+#define TEXXY_TRACE_CONCAT(a, b) TEXXY_TRACE_CONCAT_(a, b)
+
+// Traces the rest of the enclosing block
+#define TRACE_SCOPE(name) const Trace::Scope TEXXY_TRACE_CONCAT(traceScope, __LINE__)(name)
+
+#endif  // TRACE_H
@@ -0,0 +1,130 @@
+#ifndef WORDTABLE_H
+#define WORDTABLE_H
+
+#include <QStringView>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#include "language_support.h"
+
+/**
+ * WordEntry
+ * ---------
+ * One ASCII word and the token kind it is highlighted as.
+ */
+struct WordEntry {
+    std::string_view word;
+    TokenKind kind;
+};
+
+/**
+ * WordTable
+ * ---------
+ * A perfect hash from a fixed word list to token kinds, built at compile time.
+ * The constructor searches for a hash seed that gives every word its own slot,
+ * so classify() hashes the identifier once and compares against at most one
+ * candidate. Nothing is allocated and the table is shared by every highlighter.
+ *
+ * Slots must be a power of two and at least a few times the number of words;
+ * if no seed is found the constructor throws, which fails a constexpr build.
+ */
+template <std::size_t N, std::size_t Slots>
+class WordTable {
+    static_assert((Slots & (Slots - 1)) == 0, "Slots must be a power of two");
+    static_assert(N < 255, "Slot indexes are stored in a byte");
+
+   public:
+    constexpr explicit WordTable(const WordEntry (&entries)[N]) {
+        for (std::size_t i = 0; i < N; ++i) {
+            m_entries[i] = entries[i];
+            if (entries[i].word.size() > m_maxLength) {
+                m_maxLength = entries[i].word.size();
+            }
+        }
+
+        for (std::uint32_t seed = 0; seed < MaxSeed; ++seed) {
+            if (tryPlace(seed)) {
+                m_seed = seed;
+                return;
+            }
+        }
+        throw "WordTable: no collision-free seed, increase Slots";
+    }
+
+    /**
+     * @brief Looks up an identifier.
+     * @param word The identifier; words with non-ASCII characters never match.
+     * @param kind Receives the token kind when the word is in the table.
+     * @return true if the word is in the table.
+     */
+    bool classify(QStringView word, TokenKind* kind) const {
+        const std::size_t length = static_cast<std::size_t>(word.size());
+        if (length == 0 || length > m_maxLength) {
+            return false;
+        }
+
+        std::uint32_t h = seedBasis(m_seed);
+        for (QChar c : word) {
+            const char16_t u = c.unicode();
+            if (u >= 128) {
+                return false;
+            }
+            h = (h ^ u) * 16777619u;
+        }
+
+        const std::uint8_t index = m_slots[finish(h) & (Slots - 1)];
+        if (index == Empty) {
+            return false;
+        }
+
+        const std::string_view candidate = m_entries[index].word;
+        if (candidate.size() != length) {
+            return false;
+        }
+        for (std::size_t i = 0; i < length; ++i) {
+            if (candidate[i] != word[static_cast<qsizetype>(i)].unicode()) {
+                return false;
+            }
+        }
+        *kind = m_entries[index].kind;
+        return true;
+    }
+
+   private:
+    static constexpr std::uint8_t Empty = 0xFF;
+    static constexpr std::uint32_t MaxSeed = 100000;
+
+    // FNV-1a, started from a seed-dependent basis and finished with a shift to mix high bits down
+    static constexpr std::uint32_t seedBasis(std::uint32_t seed) { return 2166136261u ^ (seed * 0x9E3779B9u); }
+    static constexpr std::uint32_t finish(std::uint32_t h) { return h ^ (h >> 15); }
+
+    static constexpr std::uint32_t hash(std::string_view word, std::uint32_t seed) {
+        std::uint32_t h = seedBasis(seed);
+        for (char c : word) {
+            h = (h ^ static_cast<std::uint8_t>(c)) * 16777619u;
+        }
+        return finish(h);
+    }
+
+    constexpr bool tryPlace(std::uint32_t seed) {
+        for (std::size_t i = 0; i < Slots; ++i) {
+            m_slots[i] = Empty;
+        }
+        for (std::size_t i = 0; i < N; ++i) {
+            std::uint8_t& slot = m_slots[hash(m_entries[i].word, seed) & (Slots - 1)];
+            if (slot != Empty) {
+                return false;
+            }
+            slot = static_cast<std::uint8_t>(i);
+        }
+        return true;
+    }
+
+    WordEntry m_entries[N] = {};
+    std::uint8_t m_slots[Slots] = {};
+    std::size_t m_maxLength = 0;
+    std::uint32_t m_seed = 0;
+};
+
+#endif  // WORDTABLE_H